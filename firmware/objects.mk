@@ -24,6 +24,10 @@ firmware-cflags-y   +=	-fPIE -pie
 firmware-ldflags-y  +=	-Wl,--no-dynamic-linker -Wl,-pie
 endif
 
+ifeq ($(FW_TRAP_VECTORED),y)
+firmware-genflags-y +=	-DFW_TRAP_VECTORED
+endif
+
 ifdef FW_TEXT_START
 firmware-genflags-y += -DFW_TEXT_START=$(FW_TEXT_START)
 endif
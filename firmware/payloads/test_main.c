@@ -26,15 +26,83 @@
 #define SBI_ECALL_0(__eid, __fid) SBI_ECALL(__eid, __fid, 0, 0, 0)
 #define SBI_ECALL_1(__eid, __fid, __a0) SBI_ECALL(__eid, __fid, __a0, 0, 0)
 #define SBI_ECALL_2(__eid, __fid, __a0, __a1) SBI_ECALL(__eid, __fid, __a0, __a1, 0)
+#define SBI_ECALL_3(__eid, __fid, __a0, __a1, __a2) SBI_ECALL(__eid, __fid, __a0, __a1, __a2)
 
 #define sbi_ecall_console_putc(c) SBI_ECALL_1(SBI_EXT_0_1_CONSOLE_PUTCHAR, 0, (c))
 
+/* Returns the SBI error and the number of bytes written in *out */
+static inline long sbi_ecall_console_write(const char *str, unsigned long len,
+					   unsigned long *out)
+{
+	register unsigned long a0 asm("a0") = len;
+	register unsigned long a1 asm("a1") = (unsigned long)str;
+	register unsigned long a2 asm("a2") = 0;
+	register unsigned long a6 asm("a6") = SBI_EXT_DBCN_CONSOLE_WRITE;
+	register unsigned long a7 asm("a7") = SBI_EXT_DBCN;
+
+	asm volatile("ecall"
+		     : "+r"(a0), "+r"(a1)
+		     : "r"(a2), "r"(a6), "r"(a7)
+		     : "memory");
+	*out = a1;
+
+	return a0;
+}
+
 static inline void sbi_ecall_console_puts(const char *str)
 {
+	unsigned long len = 0, written;
+
+	while (str && str[len])
+		len++;
+
+	/* DBCN may write fewer bytes than requested so loop until done */
+	while (len) {
+		if (sbi_ecall_console_write(str, len, &written))
+			break;
+		if (!written || len < written)
+			break;
+		str += written;
+		len -= written;
+	}
+
+	/* Fallback to legacy putchar if DBCN extension is not available */
 	while (str && *str)
 		sbi_ecall_console_putc(*str++);
 }
 
+#define sbi_ecall_xmulti_set_shmem(lo, hi) \
+	SBI_ECALL_2(SBI_EXT_XMULTI, SBI_EXT_XMULTI_SET_SHMEM, (lo), (hi))
+
+#define sbi_ecall_xmulti_call(n) \
+	SBI_ECALL_1(SBI_EXT_XMULTI, SBI_EXT_XMULTI_CALL, (n))
+
+static unsigned long xmulti_shmem[SBI_XMULTI_SHMEM_SIZE /
+				  sizeof(unsigned long)]
+	__attribute__((aligned(SBI_XMULTI_SHMEM_SIZE)));
+
+/* HART stop never returns so it must be rejected inside a multi-call */
+static void test_xmulti_hsm_denied(void)
+{
+	unsigned long *rec = xmulti_shmem;
+
+	if (sbi_ecall_xmulti_set_shmem(xmulti_shmem, 0) != SBI_SUCCESS)
+		return;
+
+	rec[SBI_XMULTI_REC_EXTID] = SBI_EXT_HSM;
+	rec[SBI_XMULTI_REC_FUNCID] = SBI_EXT_HSM_HART_STOP;
+	rec[SBI_XMULTI_REC_ERROR] = SBI_SUCCESS;
+
+	if (sbi_ecall_xmulti_call(1) == SBI_SUCCESS &&
+	    rec[SBI_XMULTI_REC_ERROR] == (unsigned long)SBI_ERR_DENIED)
+		sbi_ecall_console_puts("XMULTI HSM record denied: PASS\n");
+	else
+		sbi_ecall_console_puts("XMULTI HSM record denied: FAIL\n");
+
+	sbi_ecall_xmulti_set_shmem(SBI_XMULTI_SHMEM_DISABLE,
+				   SBI_XMULTI_SHMEM_DISABLE);
+}
+
 #define wfi()                                             \
 	do {                                              \
 		__asm__ __volatile__("wfi" ::: "memory"); \
@@ -44,6 +112,8 @@ void test_main(unsigned long a0, unsigned long a1)
 {
 	sbi_ecall_console_puts("\nTest payload running\n");
 
+	test_xmulti_hsm_denied();
+
 	while (1)
 		wfi();
 }
@@ -38,6 +38,14 @@ unsigned int atomic_raw_xchg_uint(volatile unsigned int *ptr,
 
 unsigned long atomic_raw_xchg_ulong(volatile unsigned long *ptr,
 				    unsigned long newval);
+
+/**
+ * OR a mask in any address and return the old value.
+ * @ptr: Address to modify
+ * @mask: Bits to set
+ */
+unsigned long atomic_raw_or_ulong(volatile unsigned long *ptr,
+				  unsigned long mask);
 /**
  * Set a bit in an atomic variable and return the new value.
  * @nr : Bit to set.
@@ -30,6 +30,7 @@ struct sbi_domain_memregion {
 	 * It has to be minimum 3 and maximum __riscv_xlen
 	 */
 	unsigned long order;
+#define SBI_DOMAIN_MEMREGION_MIN_ORDER		3
 	/**
 	 * Base address of memory region
 	 * It must be 2^order aligned address
@@ -154,6 +155,21 @@ bool sbi_domain_check_addr(const struct sbi_domain *dom,
 			   unsigned long addr, unsigned long mode,
 			   unsigned long access_flags);
 
+/**
+ * Check whether we can access every byte of specified address range
+ * for given mode and memory region flags under a domain
+ * @param dom pointer to domain
+ * @param addr the start address of the range
+ * @param size the size of the range in bytes
+ * @param mode the privilege mode of access
+ * @param access_flags bitmask of domain access types (enum sbi_domain_access)
+ * @return TRUE if access allowed otherwise FALSE
+ */
+bool sbi_domain_check_addr_range(const struct sbi_domain *dom,
+				 unsigned long addr, unsigned long size,
+				 unsigned long mode,
+				 unsigned long access_flags);
+
 /** Dump domain details on the console */
 void sbi_domain_dump(const struct sbi_domain *dom, const char *suffix);
 
@@ -17,6 +17,7 @@
 #define SBI_ECALL_VERSION_MINOR		0
 #define SBI_OPENSBI_IMPID		1
 
+struct sbi_scratch;
 struct sbi_trap_regs;
 struct sbi_trap_info;
 
@@ -40,6 +41,10 @@ extern struct sbi_ecall_extension ecall_vendor;
 extern struct sbi_ecall_extension ecall_hsm;
 extern struct sbi_ecall_extension ecall_srst;
 extern struct sbi_ecall_extension ecall_pmu;
+extern struct sbi_ecall_extension ecall_dbcn;
+extern struct sbi_ecall_extension ecall_xrfence;
+extern struct sbi_ecall_extension ecall_xdebug;
+extern struct sbi_ecall_extension ecall_xmulti;
 
 u16 sbi_ecall_version_major(void);
 
@@ -57,6 +62,22 @@ void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext);
 
 int sbi_ecall_handler(struct sbi_trap_regs *regs);
 
+extern unsigned long sbi_ecall_fast_enabled;
+
+int sbi_ecall_fast_set_timer(unsigned long a0, unsigned long a1);
+
+int sbi_ecall_fast_send_ipi(unsigned long hmask, unsigned long hbase);
+
+int sbi_ecall_prof_snapshot(u32 hartid, unsigned long addr,
+			    unsigned long max_entries,
+			    unsigned long *out_count);
+
+int sbi_ecall_prof_reset(u32 hartid);
+
+void sbi_ecall_prof_dump(struct sbi_scratch *scratch);
+
+int sbi_ecall_xmulti_init(void);
+
 int sbi_ecall_init(void);
 
 #endif
@@ -29,6 +29,10 @@
 #define SBI_EXT_HSM				0x48534D
 #define SBI_EXT_SRST				0x53525354
 #define SBI_EXT_PMU				0x504D55
+#define SBI_EXT_DBCN				0x4442434E
+#define SBI_EXT_XRFENCE				0x08000000
+#define SBI_EXT_XDEBUG				0x08000001
+#define SBI_EXT_XMULTI				0x08000002
 
 /* SBI function IDs for BASE extension*/
 #define SBI_EXT_BASE_GET_SPEC_VERSION		0x0
@@ -54,6 +58,100 @@
 #define SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA_ASID	0x5
 #define SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA	0x6
 
+/*
+ * SBI function IDs for OpenSBI experimental XRFENCE extension
+ *
+ * Function IDs 0x0 to 0x6 are same as the RFENCE extension with an
+ * additional flags parameter in the argument register following the
+ * RFENCE arguments.
+ */
+#define SBI_EXT_XRFENCE_SET_COMPLETION_SHMEM	0x10
+#define SBI_EXT_XRFENCE_GET_STATUS		0x11
+#define SBI_EXT_XRFENCE_WAIT			0x12
+
+#define SBI_XRFENCE_FLAG_ASYNC			(1UL << 0)
+/* Page order of the mappings (i.e. stride is 4KB << order) */
+#define SBI_XRFENCE_FLAG_ORDER_SHIFT		8
+#define SBI_XRFENCE_FLAG_ORDER_MASK		(0x3fUL << \
+						 SBI_XRFENCE_FLAG_ORDER_SHIFT)
+#define SBI_XRFENCE_FLAGS_MASK			(SBI_XRFENCE_FLAG_ASYNC | \
+						 SBI_XRFENCE_FLAG_ORDER_MASK)
+
+#define SBI_XRFENCE_SHMEM_DISABLE		-1UL
+
+/* SBI function IDs for OpenSBI experimental XDEBUG extension */
+#define SBI_EXT_XDEBUG_IPI_STATS_READ		0x0
+#define SBI_EXT_XDEBUG_IPI_STATS_DUMP		0x1
+#define SBI_EXT_XDEBUG_IPI_STATS_RESET		0x2
+#define SBI_EXT_XDEBUG_ECALL_PROF_SNAPSHOT	0x3
+#define SBI_EXT_XDEBUG_ECALL_PROF_RESET		0x4
+#define SBI_EXT_XDEBUG_TRAP_STATS_READ		0x5
+#define SBI_EXT_XDEBUG_TRAP_STATS_DUMP		0x6
+#define SBI_EXT_XDEBUG_TRAP_STATS_RESET		0x7
+
+/* IPI statistics of XDEBUG extension */
+#define SBI_XDEBUG_IPI_STAT_SENT		0x0
+#define SBI_XDEBUG_IPI_STAT_RECVD		0x1
+#define SBI_XDEBUG_IPI_STAT_COALESCED		0x2
+/*
+ * Bucket 0 of the latency histogram counts zero latency whereas bucket
+ * N counts latency in [2^(N-1), 2^N) timer ticks. The last bucket also
+ * counts all larger latencies.
+ */
+#define SBI_XDEBUG_IPI_STAT_LAT_HIST(__n)	(0x10 + (__n))
+
+/*
+ * Each ecall profile entry written by ECALL_PROF_SNAPSHOT consists of
+ * 64-bit words in the order: extension ID, function ID, call count,
+ * total M-mode cycles, and maximum M-mode cycles.
+ */
+#define SBI_XDEBUG_ECALL_PROF_ENTRY_WORDS	5
+
+/* Trap causes accounted by XDEBUG trap statistics */
+#define SBI_XDEBUG_TRAP_CAUSE_IRQ_M_SOFT	0x0
+#define SBI_XDEBUG_TRAP_CAUSE_IRQ_M_TIMER	0x1
+#define SBI_XDEBUG_TRAP_CAUSE_IRQ_M_EXT		0x2
+#define SBI_XDEBUG_TRAP_CAUSE_IRQ_OTHER		0x3
+#define SBI_XDEBUG_TRAP_CAUSE_ILLEGAL_INSN	0x4
+#define SBI_XDEBUG_TRAP_CAUSE_MISALIGNED_LOAD	0x5
+#define SBI_XDEBUG_TRAP_CAUSE_MISALIGNED_STORE	0x6
+#define SBI_XDEBUG_TRAP_CAUSE_ECALL		0x7
+#define SBI_XDEBUG_TRAP_CAUSE_REDIRECT		0x8
+#define SBI_XDEBUG_TRAP_CAUSE_EXCP_OTHER	0x9
+#define SBI_XDEBUG_TRAP_CAUSE_MAX		0xa
+
+/* Trap statistics of XDEBUG extension */
+#define SBI_XDEBUG_TRAP_STAT_COUNT		0x0
+#define SBI_XDEBUG_TRAP_STAT_CYCLES		0x1
+/*
+ * Bucket 0 of the duration histogram counts zero cycles whereas bucket
+ * N counts durations in [2^(N-1), 2^N) cycles. The last bucket also
+ * counts all longer durations.
+ */
+#define SBI_XDEBUG_TRAP_STAT_CYCLES_HIST(__n)	(0x10 + (__n))
+
+/* SBI function IDs for OpenSBI experimental XMULTI extension */
+#define SBI_EXT_XMULTI_SET_SHMEM		0x0
+#define SBI_EXT_XMULTI_CALL			0x1
+
+#define SBI_XMULTI_SHMEM_DISABLE		-1UL
+#define SBI_XMULTI_SHMEM_SIZE			4096
+
+/*
+ * Each multi-call record in the shared memory consists of below
+ * XLEN-bit words. The error and value of each call are written back
+ * to the record.
+ */
+#define SBI_XMULTI_REC_EXTID			0
+#define SBI_XMULTI_REC_FUNCID			1
+#define SBI_XMULTI_REC_ARG(__n)			(2 + (__n))
+#define SBI_XMULTI_REC_ERROR			8
+#define SBI_XMULTI_REC_VALUE			9
+#define SBI_XMULTI_REC_WORDS			10
+#define SBI_XMULTI_MAX_RECORDS			(SBI_XMULTI_SHMEM_SIZE / \
+						 (SBI_XMULTI_REC_WORDS * \
+						  __SIZEOF_POINTER__))
+
 /* SBI function IDs for HSM extension */
 #define SBI_EXT_HSM_HART_START			0x0
 #define SBI_EXT_HSM_HART_STOP			0x1
@@ -99,6 +197,14 @@
 #define SBI_EXT_PMU_COUNTER_START	0x3
 #define SBI_EXT_PMU_COUNTER_STOP	0x4
 #define SBI_EXT_PMU_COUNTER_FW_READ	0x5
+#define SBI_EXT_PMU_SNAPSHOT_SET_SHMEM	0x7
+
+/* SBI function IDs for DBCN extension */
+#define SBI_EXT_DBCN_CONSOLE_WRITE		0x0
+#define SBI_EXT_DBCN_CONSOLE_READ		0x1
+#define SBI_EXT_DBCN_CONSOLE_WRITE_BYTE		0x2
+
+#ifndef __ASSEMBLER__
 
 /** General pmu event codes specified in SBI PMU extension */
 enum sbi_pmu_hw_generic_events_t {
@@ -182,6 +288,12 @@ enum sbi_pmu_fw_event_code_id {
 	SBI_PMU_FW_HFENCE_VVMA_ASID_SENT = 20,
 	SBI_PMU_FW_HFENCE_VVMA_ASID_RCVD = 21,
 	SBI_PMU_FW_MAX,
+
+	/* SBI implementation specific events fed by trap statistics */
+	SBI_PMU_FW_IMPL_START		= 256,
+	SBI_PMU_FW_MMODE_TRAPS		= SBI_PMU_FW_IMPL_START,
+	SBI_PMU_FW_MMODE_CYCLES		= 257,
+	SBI_PMU_FW_IMPL_END,
 };
 
 /** SBI PMU event idx type */
@@ -199,6 +311,8 @@ enum sbi_pmu_ctr_type {
 	SBI_PMU_CTR_TYPE_FW,
 };
 
+#endif
+
 /* Helper macros to decode event idx */
 #define SBI_PMU_EVENT_IDX_OFFSET 20
 #define SBI_PMU_EVENT_IDX_MASK 0xFFFFF
@@ -226,14 +340,27 @@ enum sbi_pmu_ctr_type {
 
 /* Flags defined for counter start function */
 #define SBI_PMU_START_FLAG_SET_INIT_VALUE (1 << 0)
+#define SBI_PMU_START_FLAG_INIT_SNAPSHOT (1 << 1)
 
 /* Flags defined for counter stop function */
 #define SBI_PMU_STOP_FLAG_RESET (1 << 0)
+#define SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT (1 << 1)
+
+/* PMU snapshot shared memory */
+#define SBI_PMU_SNAPSHOT_SHMEM_DISABLE	-1UL
+#define SBI_PMU_SNAPSHOT_SHMEM_SIZE	4096
+/*
+ * Snapshot layout: u64 overflow bitmap followed by u64 counter values.
+ * Bit i of the bitmap and value i correspond to counter (cidx_base + i).
+ */
+#define SBI_PMU_SNAPSHOT_CTR_MAX	64
 
 /* SBI base specification related macros */
 #define SBI_SPEC_VERSION_MAJOR_OFFSET		24
 #define SBI_SPEC_VERSION_MAJOR_MASK		0x7f
 #define SBI_SPEC_VERSION_MINOR_MASK		0xffffff
+#define SBI_EXT_EXPERIMENTAL_START		0x08000000
+#define SBI_EXT_EXPERIMENTAL_END		0x08FFFFFF
 #define SBI_EXT_VENDOR_START			0x09000000
 #define SBI_EXT_VENDOR_END			0x09FFFFFF
 #define SBI_EXT_FIRMWARE_START			0x0A000000
@@ -249,8 +376,9 @@ enum sbi_pmu_ctr_type {
 #define SBI_ERR_ALREADY_AVAILABLE		-6
 #define SBI_ERR_ALREADY_STARTED			-7
 #define SBI_ERR_ALREADY_STOPPED			-8
+#define SBI_ERR_NO_SHMEM			-9
 
-#define SBI_LAST_ERR				SBI_ERR_ALREADY_STOPPED
+#define SBI_LAST_ERR				SBI_ERR_NO_SHMEM
 
 /* clang-format on */
 
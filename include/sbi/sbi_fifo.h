@@ -11,18 +11,31 @@
 #ifndef __SBI_FIFO_H__
 #define __SBI_FIFO_H__
 
-#include <sbi/riscv_locks.h>
+#include <sbi/riscv_atomic.h>
 #include <sbi/sbi_types.h>
 
+/**
+ * Lock-free multi-producer/single-consumer fifo
+ *
+ * Producers reserve a slot by advancing the head counter and the
+ * owner of the fifo (i.e. the only consumer) advances the tail counter.
+ * Each slot has a state word which is used to hand over the slot
+ * between the producer, the consumer and in-place updaters.
+ */
 struct sbi_fifo {
 	void *queue;
-	spinlock_t qlock;
+	atomic_t *slot_state;
+	atomic_t head;
+	unsigned long tail;
 	u16 entry_size;
 	u16 num_entries;
-	u16 avail;
-	u16 tail;
 };
 
+/** Memory required by fifo queue having given entries and entry size */
+#define SBI_FIFO_QUEUE_MEM_SIZE(__entries, __entry_size)		\
+	(ROUNDUP((__entries) * (__entry_size), sizeof(atomic_t)) +	\
+	 ((__entries) * sizeof(atomic_t)))
+
 enum sbi_fifo_inplace_update_types {
 	SBI_FIFO_SKIP,
 	SBI_FIFO_UPDATED,
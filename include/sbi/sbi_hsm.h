@@ -48,6 +48,7 @@ struct sbi_hsm_device {
 };
 
 struct sbi_domain;
+struct sbi_hartmask;
 struct sbi_scratch;
 
 const struct sbi_hsm_device *sbi_hsm_get_device(void);
@@ -68,6 +69,8 @@ int sbi_hsm_hart_suspend(struct sbi_scratch *scratch, u32 suspend_type,
 int sbi_hsm_hart_get_state(const struct sbi_domain *dom, u32 hartid);
 int sbi_hsm_hart_interruptible_mask(const struct sbi_domain *dom,
 				    ulong hbase, ulong *out_hmask);
+int sbi_hsm_hart_interruptible_hartmask(const struct sbi_domain *dom,
+					struct sbi_hartmask *out_hmask);
 void sbi_hsm_prepare_next_jump(struct sbi_scratch *scratch, u32 hartid);
 
 #endif
@@ -11,13 +11,28 @@
 #define __SBI_IPI_H__
 
 #include <sbi/sbi_types.h>
+#include <sbi/sbi_hartmask.h>
 
 /* clang-format off */
 
 #define SBI_IPI_EVENT_MAX			__riscv_xlen
 
+/** Number of IPI events for which statistics are collected */
+#define SBI_IPI_STATS_EVENT_MAX			8
+
+/** Number of buckets in the IPI latency histogram */
+#define SBI_IPI_STATS_LAT_BUCKETS		16
+
 /* clang-format on */
 
+/** Priority of IPI events (pending events are processed by priority) */
+enum sbi_ipi_event_prio {
+	SBI_IPI_EVENT_PRIO_HIGH = 0,
+	SBI_IPI_EVENT_PRIO_NORMAL,
+	SBI_IPI_EVENT_PRIO_LOW,
+	SBI_IPI_EVENT_PRIO_MAX
+};
+
 /** IPI hardware device */
 struct sbi_ipi_device {
 	/** Name of the IPI device */
@@ -28,6 +43,13 @@ struct sbi_ipi_device {
 
 	/** Clear IPI for a target HART */
 	void (*ipi_clear)(u32 target_hart);
+
+	/**
+	 * Send IPI to a set of target HARTs
+	 * Note: This is an optional callback and when available it is
+	 * used instead of ipi_send() for sending IPIs to many HARTs.
+	 */
+	void (*ipi_send_mask)(const struct sbi_hartmask *mask);
 };
 
 struct sbi_scratch;
@@ -61,9 +83,18 @@ struct sbi_ipi_event_ops {
 	void (* process)(struct sbi_scratch *scratch);
 };
 
+int sbi_ipi_send_hartmask(const struct sbi_hartmask *hmask,
+			  u32 event, void *data);
+
 int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data);
 
-int sbi_ipi_event_create(const struct sbi_ipi_event_ops *ops);
+int sbi_ipi_set_pending(u32 hartid, u32 event);
+
+int sbi_ipi_set_cluster(u32 hartid, u32 cluster);
+
+void sbi_ipi_forward_pending(void);
+
+int sbi_ipi_event_create(const struct sbi_ipi_event_ops *ops, u32 prio);
 
 void sbi_ipi_event_destroy(u32 event);
 
@@ -75,6 +106,13 @@ int sbi_ipi_send_halt(ulong hmask, ulong hbase);
 
 void sbi_ipi_process(void);
 
+int sbi_ipi_stats_read(u32 hartid, u32 event, unsigned long stat,
+		       unsigned long *out_val);
+
+int sbi_ipi_stats_reset(u32 hartid);
+
+int sbi_ipi_stats_dump(u32 hartid);
+
 int sbi_ipi_raw_send(u32 target_hart);
 
 const struct sbi_ipi_device *sbi_ipi_get_device(void);
@@ -114,7 +114,7 @@ struct sbi_platform_operations {
 	/** Exit IPI for current HART */
 	void (*ipi_exit)(void);
 
-	/** Get tlb flush limit value **/
+	/** Get tlb flush limit value (zero to calibrate at boot) **/
 	u64 (*get_tlbr_flush_limit)(void);
 
 	/** Initialize platform timer for current HART */
@@ -299,14 +299,14 @@ static inline unsigned long sbi_platform_get_features(
  *
  * @param plat pointer to struct sbi_platform
  *
- * @return tlb range flush limit value. Returns a default (page size) if not
- * defined by platform.
+ * @return tlb range flush limit value. Returns zero if not defined by
+ * platform in which case the limit is calibrated at boot time on each HART.
  */
 static inline u64 sbi_platform_tlbr_flush_limit(const struct sbi_platform *plat)
 {
 	if (plat && sbi_platform_ops(plat)->get_tlbr_flush_limit)
 		return sbi_platform_ops(plat)->get_tlbr_flush_limit();
-	return SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT;
+	return 0;
 }
 
 /**
@@ -63,6 +63,9 @@ int sbi_pmu_ctr_start(unsigned long cidx_base, unsigned long cidx_mask,
 
 int sbi_pmu_ctr_get_info(uint32_t cidx, unsigned long *ctr_info);
 
+int sbi_pmu_snapshot_set_shmem(unsigned long lo, unsigned long hi,
+			       unsigned long flags);
+
 unsigned long sbi_pmu_num_ctr(void);
 
 int sbi_pmu_ctr_cfg_match(unsigned long cidx_base, unsigned long cidx_mask,
@@ -71,4 +74,6 @@ int sbi_pmu_ctr_cfg_match(unsigned long cidx_base, unsigned long cidx_mask,
 
 int sbi_pmu_ctr_incr_fw(enum sbi_pmu_fw_event_code_id fw_id);
 
+int sbi_pmu_ctr_add_fw(enum sbi_pmu_fw_event_code_id fw_id, unsigned long val);
+
 #endif
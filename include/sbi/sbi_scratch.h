@@ -139,6 +139,10 @@ enum sbi_scratch_options {
 	SBI_SCRATCH_NO_BOOT_PRINTS = (1 << 0),
 	/** Enable runtime debug prints */
 	SBI_SCRATCH_DEBUG_PRINTS = (1 << 1),
+	/** Enable profiling of ecalls */
+	SBI_SCRATCH_ECALL_PROFILE = (1 << 2),
+	/** Enable per-cause trap statistics */
+	SBI_SCRATCH_TRAP_STATS = (1 << 3),
 };
 
 /** Get pointer to sbi_scratch for current HART */
@@ -205,10 +205,26 @@ struct sbi_trap_info {
 int sbi_trap_redirect(struct sbi_trap_regs *regs,
 		      struct sbi_trap_info *trap);
 
+int sbi_trap_irq_handler(struct sbi_trap_regs *regs);
+
 struct sbi_trap_regs *sbi_trap_handler(struct sbi_trap_regs *regs);
 
 void __noreturn sbi_trap_exit(const struct sbi_trap_regs *regs);
 
+/** Number of buckets in the trap duration histogram */
+#define SBI_TRAP_STATS_HIST_BUCKETS	16
+
+struct sbi_scratch;
+
+int sbi_trap_stats_init(struct sbi_scratch *scratch, bool cold_boot);
+
+int sbi_trap_stats_read(u32 hartid, u32 cause, unsigned long stat,
+			unsigned long *out_val);
+
+int sbi_trap_stats_reset(u32 hartid);
+
+int sbi_trap_stats_dump(u32 hartid);
+
 #endif
 
 #endif
@@ -39,6 +39,8 @@ struct imsic_data *imsic_get_data(u32 hartid);
 
 int imsic_get_target_file(u32 hartid);
 
+void *imsic_get_target_doorbell(u32 hartid);
+
 void imsic_local_irqchip_init(void);
 
 int imsic_warm_irqchip_init(void);
@@ -214,6 +214,20 @@ unsigned long atomic_raw_xchg_ulong(volatile unsigned long *ptr,
 #error "Unexpected __SIZEOF_POINTER__"
 #endif
 
+unsigned long atomic_raw_or_ulong(volatile unsigned long *ptr,
+				  unsigned long mask)
+{
+	unsigned long ret;
+
+	/* Atomically OR the mask and return old value. */
+	__asm__ __volatile__(__AMO(or) ".aqrl %0, %2, %1"
+			     : "=r"(ret), "+A"(*ptr)
+			     : "r"(mask)
+			     : "memory");
+
+	return ret;
+}
+
 #define __atomic_op_bit_ord(op, mod, nr, addr, ord)                          \
 	({                                                                   \
 		unsigned long __res, __mask;                                 \
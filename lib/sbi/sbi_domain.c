@@ -140,10 +140,39 @@ bool sbi_domain_check_addr(const struct sbi_domain *dom,
 	return (mode == PRV_M) ? TRUE : FALSE;
 }
 
+bool sbi_domain_check_addr_range(const struct sbi_domain *dom,
+				 unsigned long addr, unsigned long size,
+				 unsigned long mode,
+				 unsigned long access_flags)
+{
+	unsigned long pos, end = addr + size - 1;
+
+	if (!size || end < addr)
+		return FALSE;
+
+	/*
+	 * Memory regions are naturally aligned to their size so a region
+	 * boundary can only be at a multiple of the smallest region size.
+	 * Checking the first byte of every such granule covers every
+	 * region overlapped by the range.
+	 */
+	pos = addr;
+	while (1) {
+		if (!sbi_domain_check_addr(dom, pos, mode, access_flags))
+			return FALSE;
+		pos = (pos | (BIT(SBI_DOMAIN_MEMREGION_MIN_ORDER) - 1)) + 1;
+		if (!pos || end < pos)
+			break;
+	}
+
+	return TRUE;
+}
+
 /* Check if region complies with constraints */
 static bool is_region_valid(const struct sbi_domain_memregion *reg)
 {
-	if (reg->order < 3 || __riscv_xlen < reg->order)
+	if (reg->order < SBI_DOMAIN_MEMREGION_MIN_ORDER ||
+	    __riscv_xlen < reg->order)
 		return FALSE;
 
 	if (reg->base & (BIT(reg->order) - 1))
@@ -7,10 +7,16 @@
  *   Anup Patel <anup.patel@wdc.com>
  */
 
+#include <sbi/riscv_asm.h>
 #include <sbi/sbi_console.h>
+#include <sbi/sbi_domain.h>
 #include <sbi/sbi_ecall.h>
 #include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_ipi.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_timer.h>
 #include <sbi/sbi_trap.h>
 
 u16 sbi_ecall_version_major(void)
@@ -37,22 +43,101 @@ void sbi_ecall_set_impid(unsigned long impid)
 
 static SBI_LIST_HEAD(ecall_exts_list);
 
+/*
+ * Extensions having a single extension ID are looked-up using a small
+ * open addressing hash table whereas extensions having a range of
+ * extension IDs (such as legacy and vendor extensions) are looked-up
+ * using binary search in an array sorted by extension ID.
+ */
+#define ECALL_EXT_TABLE_SIZE		32
+#define ECALL_EXT_RANGE_MAX		8
+
+static struct sbi_ecall_extension *ecall_ext_table[ECALL_EXT_TABLE_SIZE];
+static struct sbi_ecall_extension *ecall_ext_ranges[ECALL_EXT_RANGE_MAX];
+static u32 ecall_ext_range_count;
+
+static inline u32 ecall_ext_hash(unsigned long extid)
+{
+	return (extid ^ (extid >> 8) ^ (extid >> 16) ^ (extid >> 24)) &
+	       (ECALL_EXT_TABLE_SIZE - 1);
+}
+
+static int ecall_ext_index_add(struct sbi_ecall_extension *ext)
+{
+	u32 i, h;
+
+	if (ext->extid_start == ext->extid_end) {
+		h = ecall_ext_hash(ext->extid_start);
+		for (i = 0; i < ECALL_EXT_TABLE_SIZE; i++) {
+			h = (h + i) & (ECALL_EXT_TABLE_SIZE - 1);
+			if (!ecall_ext_table[h]) {
+				ecall_ext_table[h] = ext;
+				return 0;
+			}
+		}
+		return SBI_ENOSPC;
+	}
+
+	if (ECALL_EXT_RANGE_MAX <= ecall_ext_range_count)
+		return SBI_ENOSPC;
+
+	/* Keep the ranges sorted by first extension ID */
+	for (i = ecall_ext_range_count; i > 0; i--) {
+		if (ecall_ext_ranges[i - 1]->extid_start < ext->extid_start)
+			break;
+		ecall_ext_ranges[i] = ecall_ext_ranges[i - 1];
+	}
+	ecall_ext_ranges[i] = ext;
+	ecall_ext_range_count++;
+
+	return 0;
+}
+
+static void ecall_ext_index_rebuild(void)
+{
+	struct sbi_ecall_extension *t;
+
+	sbi_memset(ecall_ext_table, 0, sizeof(ecall_ext_table));
+	ecall_ext_range_count = 0;
+
+	sbi_list_for_each_entry(t, &ecall_exts_list, head)
+		ecall_ext_index_add(t);
+}
+
 struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
 {
-	struct sbi_ecall_extension *t, *ret = NULL;
+	u32 i, h, lo, hi, mid;
+	struct sbi_ecall_extension *t;
 
-	sbi_list_for_each_entry(t, &ecall_exts_list, head) {
-		if (t->extid_start <= extid && extid <= t->extid_end) {
-			ret = t;
+	h = ecall_ext_hash(extid);
+	for (i = 0; i < ECALL_EXT_TABLE_SIZE; i++) {
+		h = (h + i) & (ECALL_EXT_TABLE_SIZE - 1);
+		t = ecall_ext_table[h];
+		if (!t)
 			break;
-		}
+		if (t->extid_start == extid)
+			return t;
 	}
 
-	return ret;
+	lo = 0;
+	hi = ecall_ext_range_count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		t = ecall_ext_ranges[mid];
+		if (extid < t->extid_start)
+			hi = mid;
+		else if (t->extid_end < extid)
+			lo = mid + 1;
+		else
+			return t;
+	}
+
+	return NULL;
 }
 
 int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
 {
+	int rc;
 	struct sbi_ecall_extension *t;
 
 	if (!ext || (ext->extid_end < ext->extid_start) || !ext->handle)
@@ -67,6 +152,10 @@ int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
 			return SBI_EINVAL;
 	}
 
+	rc = ecall_ext_index_add(ext);
+	if (rc)
+		return rc;
+
 	SBI_INIT_LIST_HEAD(&ext->head);
 	sbi_list_add_tail(&ext->head, &ecall_exts_list);
 
@@ -88,8 +177,168 @@ void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext)
 		}
 	}
 
-	if (found)
+	if (found) {
 		sbi_list_del_init(&ext->head);
+		ecall_ext_index_rebuild();
+		if (ext == &ecall_time || ext == &ecall_ipi)
+			sbi_ecall_fast_enabled = 0;
+	}
+}
+
+/* Number of (extension ID, function ID) pairs profiled per HART */
+#define ECALL_PROF_ENTRIES		32
+
+struct ecall_prof_entry {
+	unsigned long extid;
+	unsigned long funcid;
+	unsigned long count;
+	u64 cycles;
+	u64 max_cycles;
+};
+
+struct ecall_prof {
+	/** Number of ecalls which did not fit in the entries */
+	unsigned long dropped;
+	struct ecall_prof_entry entries[ECALL_PROF_ENTRIES];
+};
+
+/* Offset of per-HART ecall profile (zero when profiling is disabled) */
+static unsigned long ecall_prof_off;
+
+static void ecall_prof_record(unsigned long extid, unsigned long funcid,
+			      u64 cycles)
+{
+	u32 i, h;
+	struct ecall_prof_entry *e;
+	struct ecall_prof *prof =
+			sbi_scratch_thishart_offset_ptr(ecall_prof_off);
+
+	h = ecall_ext_hash(extid) + funcid;
+	for (i = 0; i < ECALL_PROF_ENTRIES; i++) {
+		e = &prof->entries[(h + i) & (ECALL_PROF_ENTRIES - 1)];
+		if (!e->count) {
+			e->extid = extid;
+			e->funcid = funcid;
+		} else if (e->extid != extid || e->funcid != funcid) {
+			continue;
+		}
+
+		e->count++;
+		e->cycles += cycles;
+		if (e->max_cycles < cycles)
+			e->max_cycles = cycles;
+		return;
+	}
+
+	prof->dropped++;
+}
+
+int sbi_ecall_prof_snapshot(u32 hartid, unsigned long addr,
+			    unsigned long max_entries,
+			    unsigned long *out_count)
+{
+	u32 i;
+	u64 *out = (u64 *)addr;
+	unsigned long count = 0, size;
+	struct ecall_prof_entry *e;
+	struct ecall_prof *prof;
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+	const struct sbi_domain *dom = sbi_domain_thishart_ptr();
+
+	if (!ecall_prof_off)
+		return SBI_ENOTSUPP;
+	if (!scratch)
+		return SBI_EINVAL;
+
+	if (max_entries) {
+		if (ECALL_PROF_ENTRIES < max_entries)
+			max_entries = ECALL_PROF_ENTRIES;
+		size = max_entries * SBI_XDEBUG_ECALL_PROF_ENTRY_WORDS *
+		       sizeof(*out);
+		if (!addr || (addr & (sizeof(*out) - 1)))
+			return SBI_EINVALID_ADDR;
+		if (!sbi_domain_check_addr_range(dom, addr, size, PRV_S,
+						 SBI_DOMAIN_WRITE))
+			return SBI_EINVALID_ADDR;
+	}
+
+	prof = sbi_scratch_offset_ptr(scratch, ecall_prof_off);
+	for (i = 0; i < ECALL_PROF_ENTRIES && count < max_entries; i++) {
+		e = &prof->entries[i];
+		if (!e->count)
+			continue;
+
+		*out++ = e->extid;
+		*out++ = e->funcid;
+		*out++ = e->count;
+		*out++ = e->cycles;
+		*out++ = e->max_cycles;
+		count++;
+	}
+
+	*out_count = count;
+	return 0;
+}
+
+int sbi_ecall_prof_reset(u32 hartid)
+{
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+
+	if (!ecall_prof_off)
+		return SBI_ENOTSUPP;
+	if (!scratch)
+		return SBI_EINVAL;
+
+	sbi_memset(sbi_scratch_offset_ptr(scratch, ecall_prof_off), 0,
+		   sizeof(struct ecall_prof));
+
+	return 0;
+}
+
+void sbi_ecall_prof_dump(struct sbi_scratch *scratch)
+{
+	u32 i;
+	struct ecall_prof_entry *e;
+	struct ecall_prof *prof;
+
+	if (!ecall_prof_off)
+		return;
+
+	prof = sbi_scratch_offset_ptr(scratch, ecall_prof_off);
+	sbi_printf("HART%u ecall profile (dropped %lu):\n",
+		   current_hartid(), prof->dropped);
+	for (i = 0; i < ECALL_PROF_ENTRIES; i++) {
+		e = &prof->entries[i];
+		if (!e->count)
+			continue;
+
+		sbi_printf("  ext=0x%lx func=0x%lx count=%lu "
+			   "cycles=%lu max_cycles=%lu\n",
+			   e->extid, e->funcid, e->count,
+			   (unsigned long)e->cycles,
+			   (unsigned long)e->max_cycles);
+	}
+}
+
+/*
+ * Non-zero when the set_timer and send_ipi calls are handled by the
+ * fast path of trap entry which calls below routines directly.
+ */
+unsigned long sbi_ecall_fast_enabled;
+
+int sbi_ecall_fast_set_timer(unsigned long a0, unsigned long a1)
+{
+#if __riscv_xlen == 32
+	sbi_timer_event_start((((u64)a1 << 32) | (u64)a0));
+#else
+	sbi_timer_event_start((u64)a0);
+#endif
+	return 0;
+}
+
+int sbi_ecall_fast_send_ipi(unsigned long hmask, unsigned long hbase)
+{
+	return sbi_ipi_send_smode(hmask, hbase);
 }
 
 int sbi_ecall_handler(struct sbi_trap_regs *regs)
@@ -101,6 +350,10 @@ int sbi_ecall_handler(struct sbi_trap_regs *regs)
 	struct sbi_trap_info trap = {0};
 	unsigned long out_val = 0;
 	bool is_0_1_spec = 0;
+	unsigned long start_cycle = 0;
+
+	if (ecall_prof_off)
+		start_cycle = csr_read(CSR_MCYCLE);
 
 	ext = sbi_ecall_find_extension(extension_id);
 	if (ext && ext->handle) {
@@ -138,14 +391,25 @@ int sbi_ecall_handler(struct sbi_trap_regs *regs)
 			regs->a1 = out_val;
 	}
 
+	if (ecall_prof_off)
+		ecall_prof_record(extension_id, func_id,
+				  csr_read(CSR_MCYCLE) - start_cycle);
+
 	return 0;
 }
 
 int sbi_ecall_init(void)
 {
 	int ret;
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+
+	if (scratch->options & SBI_SCRATCH_ECALL_PROFILE) {
+		ecall_prof_off = sbi_scratch_alloc_offset(
+						sizeof(struct ecall_prof));
+		if (!ecall_prof_off)
+			return SBI_ENOMEM;
+	}
 
-	/* The order of below registrations is performance optimized */
 	ret = sbi_ecall_register_extension(&ecall_time);
 	if (ret)
 		return ret;
@@ -165,6 +429,21 @@ int sbi_ecall_init(void)
 	if (ret)
 		return ret;
 	ret = sbi_ecall_register_extension(&ecall_pmu);
+	if (ret)
+		return ret;
+	ret = sbi_ecall_register_extension(&ecall_dbcn);
+	if (ret)
+		return ret;
+	ret = sbi_ecall_register_extension(&ecall_xrfence);
+	if (ret)
+		return ret;
+	ret = sbi_ecall_register_extension(&ecall_xdebug);
+	if (ret)
+		return ret;
+	ret = sbi_ecall_xmulti_init();
+	if (ret)
+		return ret;
+	ret = sbi_ecall_register_extension(&ecall_xmulti);
 	if (ret)
 		return ret;
 	ret = sbi_ecall_register_extension(&ecall_legacy);
@@ -174,5 +453,12 @@ int sbi_ecall_init(void)
 	if (ret)
 		return ret;
 
+	/*
+	 * Ecall profiling and trap statistics are done only in the full
+	 * ecall handling path.
+	 */
+	if (!ecall_prof_off && !(scratch->options & SBI_SCRATCH_TRAP_STATS))
+		sbi_ecall_fast_enabled = 1;
+
 	return 0;
 }
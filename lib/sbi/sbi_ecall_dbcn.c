@@ -0,0 +1,85 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/sbi_console.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_ecall.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_trap.h>
+
+/*
+ * Bytes handled per call so that the console lock is not held for an
+ * unbounded time. Callers retry with the remaining bytes.
+ */
+#define DBCN_MAX_BYTES		256
+
+/* Check that the whole buffer is accessible to the calling S-mode */
+static bool dbcn_buffer_allowed(unsigned long addr, unsigned long len,
+				unsigned long access_flags)
+{
+	return sbi_domain_check_addr_range(sbi_domain_thishart_ptr(),
+					   addr, len, PRV_S, access_flags);
+}
+
+static int sbi_ecall_dbcn_handler(unsigned long extid, unsigned long funcid,
+				  const struct sbi_trap_regs *regs,
+				  unsigned long *out_val,
+				  struct sbi_trap_info *out_trap)
+{
+	unsigned long len;
+
+	switch (funcid) {
+	case SBI_EXT_DBCN_CONSOLE_WRITE:
+	case SBI_EXT_DBCN_CONSOLE_READ:
+		if (!regs->a0) {
+			*out_val = 0;
+			return 0;
+		}
+
+		/* Only addresses reachable by M-mode are accepted */
+		if (regs->a2)
+			return SBI_EINVAL;
+
+		/* Larger buffers are reported as partially handled */
+		len = (regs->a0 < DBCN_MAX_BYTES) ? regs->a0 : DBCN_MAX_BYTES;
+
+		if (funcid == SBI_EXT_DBCN_CONSOLE_WRITE) {
+			if (!dbcn_buffer_allowed(regs->a1, len,
+						 SBI_DOMAIN_READ))
+				return SBI_EINVAL;
+			*out_val = sbi_nputs((const char *)regs->a1, len);
+		} else {
+			if (!dbcn_buffer_allowed(regs->a1, len,
+						 SBI_DOMAIN_WRITE))
+				return SBI_EINVAL;
+			*out_val = sbi_ngets((char *)regs->a1, len);
+		}
+		return 0;
+	case SBI_EXT_DBCN_CONSOLE_WRITE_BYTE:
+		sbi_putc(regs->a0);
+		return 0;
+	default:
+		break;
+	}
+
+	return SBI_ENOTSUPP;
+}
+
+static int sbi_ecall_dbcn_probe(unsigned long extid, unsigned long *out_val)
+{
+	/* DBCN extension is usable only with a console device */
+	*out_val = sbi_console_get_device() ? 1 : 0;
+	return 0;
+}
+
+struct sbi_ecall_extension ecall_dbcn = {
+	.extid_start = SBI_EXT_DBCN,
+	.extid_end = SBI_EXT_DBCN,
+	.handle = sbi_ecall_dbcn_handler,
+	.probe = sbi_ecall_dbcn_probe,
+};
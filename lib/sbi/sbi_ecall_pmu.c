@@ -65,6 +65,9 @@ static int sbi_ecall_pmu_handler(unsigned long extid, unsigned long funcid,
 	case SBI_EXT_PMU_COUNTER_STOP:
 		ret = sbi_pmu_ctr_stop(regs->a0, regs->a1, regs->a2);
 		break;
+	case SBI_EXT_PMU_SNAPSHOT_SET_SHMEM:
+		ret = sbi_pmu_snapshot_set_shmem(regs->a0, regs->a1, regs->a2);
+		break;
 	default:
 		ret = SBI_ENOTSUPP;
 	};
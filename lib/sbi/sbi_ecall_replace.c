@@ -44,14 +44,11 @@ struct sbi_ecall_extension ecall_time = {
 	.handle = sbi_ecall_time_handler,
 };
 
-static int sbi_ecall_rfence_handler(unsigned long extid, unsigned long funcid,
+static int sbi_ecall_rfence_prepare(unsigned long funcid,
 				    const struct sbi_trap_regs *regs,
-				    unsigned long *out_val,
-				    struct sbi_trap_info *out_trap)
+				    struct sbi_tlb_info *tlb_info)
 {
-	int ret = 0;
 	unsigned long vmid;
-	struct sbi_tlb_info tlb_info;
 	u32 source_hart = current_hartid();
 
 	if (funcid >= SBI_EXT_RFENCE_REMOTE_HFENCE_GVMA_VMID &&
@@ -61,51 +58,59 @@ static int sbi_ecall_rfence_handler(unsigned long extid, unsigned long funcid,
 
 	switch (funcid) {
 	case SBI_EXT_RFENCE_REMOTE_FENCE_I:
-		SBI_TLB_INFO_INIT(&tlb_info, 0, 0, 0, 0,
-				  sbi_tlb_local_fence_i, source_hart);
-		ret = sbi_tlb_request(regs->a0, regs->a1, &tlb_info);
+		SBI_TLB_INFO_INIT(tlb_info, 0, 0, 0, 0,
+				  SBI_TLB_FENCE_I, source_hart);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_HFENCE_GVMA:
-		SBI_TLB_INFO_INIT(&tlb_info, regs->a2, regs->a3, 0, 0,
-				  sbi_tlb_local_hfence_gvma, source_hart);
-		ret = sbi_tlb_request(regs->a0, regs->a1, &tlb_info);
+		SBI_TLB_INFO_INIT(tlb_info, regs->a2, regs->a3, 0, 0,
+				  SBI_TLB_HFENCE_GVMA, source_hart);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_HFENCE_GVMA_VMID:
-		SBI_TLB_INFO_INIT(&tlb_info, regs->a2, regs->a3, 0, regs->a4,
-				  sbi_tlb_local_hfence_gvma_vmid,
+		SBI_TLB_INFO_INIT(tlb_info, regs->a2, regs->a3, 0, regs->a4,
+				  SBI_TLB_HFENCE_GVMA_VMID,
 				  source_hart);
-		ret = sbi_tlb_request(regs->a0, regs->a1, &tlb_info);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA:
 		vmid = (csr_read(CSR_HGATP) & HGATP_VMID_MASK);
 		vmid = vmid >> HGATP_VMID_SHIFT;
-		SBI_TLB_INFO_INIT(&tlb_info, regs->a2, regs->a3, 0, vmid,
-				  sbi_tlb_local_hfence_vvma, source_hart);
-		ret = sbi_tlb_request(regs->a0, regs->a1, &tlb_info);
+		SBI_TLB_INFO_INIT(tlb_info, regs->a2, regs->a3, 0, vmid,
+				  SBI_TLB_HFENCE_VVMA, source_hart);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA_ASID:
 		vmid = (csr_read(CSR_HGATP) & HGATP_VMID_MASK);
 		vmid = vmid >> HGATP_VMID_SHIFT;
-		SBI_TLB_INFO_INIT(&tlb_info, regs->a2, regs->a3, regs->a4,
-				  vmid, sbi_tlb_local_hfence_vvma_asid,
+		SBI_TLB_INFO_INIT(tlb_info, regs->a2, regs->a3, regs->a4,
+				  vmid, SBI_TLB_HFENCE_VVMA_ASID,
 				  source_hart);
-		ret = sbi_tlb_request(regs->a0, regs->a1, &tlb_info);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA:
-		SBI_TLB_INFO_INIT(&tlb_info, regs->a2, regs->a3, 0, 0,
-				  sbi_tlb_local_sfence_vma, source_hart);
-		ret = sbi_tlb_request(regs->a0, regs->a1, &tlb_info);
+		SBI_TLB_INFO_INIT(tlb_info, regs->a2, regs->a3, 0, 0,
+				  SBI_TLB_SFENCE_VMA, source_hart);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA_ASID:
-		SBI_TLB_INFO_INIT(&tlb_info, regs->a2, regs->a3, regs->a4, 0,
-				  sbi_tlb_local_sfence_vma_asid, source_hart);
-		ret = sbi_tlb_request(regs->a0, regs->a1, &tlb_info);
+		SBI_TLB_INFO_INIT(tlb_info, regs->a2, regs->a3, regs->a4, 0,
+				  SBI_TLB_SFENCE_VMA_ASID, source_hart);
 		break;
 	default:
-		ret = SBI_ENOTSUPP;
+		return SBI_ENOTSUPP;
 	};
 
-	return ret;
+	return 0;
+}
+
+static int sbi_ecall_rfence_handler(unsigned long extid, unsigned long funcid,
+				    const struct sbi_trap_regs *regs,
+				    unsigned long *out_val,
+				    struct sbi_trap_info *out_trap)
+{
+	int ret;
+	struct sbi_tlb_info tlb_info;
+
+	ret = sbi_ecall_rfence_prepare(funcid, regs, &tlb_info);
+	if (ret)
+		return ret;
+
+	return sbi_tlb_request(regs->a0, regs->a1, &tlb_info);
 }
 
 struct sbi_ecall_extension ecall_rfence = {
@@ -114,6 +119,72 @@ struct sbi_ecall_extension ecall_rfence = {
 	.handle = sbi_ecall_rfence_handler,
 };
 
+static int sbi_ecall_xrfence_handler(unsigned long extid,
+				     unsigned long funcid,
+				     const struct sbi_trap_regs *regs,
+				     unsigned long *out_val,
+				     struct sbi_trap_info *out_trap)
+{
+	int ret;
+	unsigned long flags;
+	struct sbi_tlb_info tlb_info;
+
+	switch (funcid) {
+	case SBI_EXT_XRFENCE_SET_COMPLETION_SHMEM:
+		if (regs->a0 == SBI_XRFENCE_SHMEM_DISABLE &&
+		    regs->a1 == SBI_XRFENCE_SHMEM_DISABLE)
+			return sbi_tlb_async_set_shmem(0);
+		/* Only addresses reachable by M-mode are accepted */
+		if (regs->a1 || !regs->a0)
+			return SBI_EINVALID_ADDR;
+		return sbi_tlb_async_set_shmem(regs->a0);
+	case SBI_EXT_XRFENCE_GET_STATUS:
+		*out_val = sbi_tlb_async_status();
+		return 0;
+	case SBI_EXT_XRFENCE_WAIT:
+		*out_val = sbi_tlb_async_wait();
+		return 0;
+	default:
+		break;
+	}
+
+	/* Flags follow the RFENCE arguments of given function */
+	switch (funcid) {
+	case SBI_EXT_RFENCE_REMOTE_FENCE_I:
+		flags = regs->a2;
+		break;
+	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA:
+	case SBI_EXT_RFENCE_REMOTE_HFENCE_GVMA:
+	case SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA:
+		flags = regs->a4;
+		break;
+	default:
+		flags = regs->a5;
+		break;
+	}
+	if (flags & ~SBI_XRFENCE_FLAGS_MASK)
+		return SBI_EINVAL;
+
+	ret = sbi_ecall_rfence_prepare(funcid, regs, &tlb_info);
+	if (ret)
+		return ret;
+
+	tlb_info.order = (flags & SBI_XRFENCE_FLAG_ORDER_MASK) >>
+			 SBI_XRFENCE_FLAG_ORDER_SHIFT;
+
+	if (flags & SBI_XRFENCE_FLAG_ASYNC)
+		return sbi_tlb_request_async(regs->a0, regs->a1,
+					     &tlb_info, out_val);
+
+	return sbi_tlb_request(regs->a0, regs->a1, &tlb_info);
+}
+
+struct sbi_ecall_extension ecall_xrfence = {
+	.extid_start = SBI_EXT_XRFENCE,
+	.extid_end = SBI_EXT_XRFENCE,
+	.handle = sbi_ecall_xrfence_handler,
+};
+
 static int sbi_ecall_ipi_handler(unsigned long extid, unsigned long funcid,
 				 const struct sbi_trap_regs *regs,
 				 unsigned long *out_val,
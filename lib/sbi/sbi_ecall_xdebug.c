@@ -0,0 +1,69 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_ecall.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_hartmask.h>
+#include <sbi/sbi_ipi.h>
+#include <sbi/sbi_trap.h>
+
+/* Only HARTs assigned to the domain of calling HART can be inspected */
+static bool xdebug_hart_allowed(unsigned long hartid)
+{
+	if (SBI_HARTMASK_MAX_BITS <= hartid)
+		return FALSE;
+
+	return sbi_domain_is_assigned_hart(sbi_domain_thishart_ptr(), hartid);
+}
+
+static int sbi_ecall_xdebug_handler(unsigned long extid, unsigned long funcid,
+				    const struct sbi_trap_regs *regs,
+				    unsigned long *out_val,
+				    struct sbi_trap_info *out_trap)
+{
+	if (!xdebug_hart_allowed(regs->a0))
+		return SBI_EINVAL;
+
+	switch (funcid) {
+	case SBI_EXT_XDEBUG_IPI_STATS_READ:
+		if (SBI_IPI_EVENT_MAX <= regs->a1)
+			return SBI_EINVAL;
+		return sbi_ipi_stats_read(regs->a0, regs->a1,
+					  regs->a2, out_val);
+	case SBI_EXT_XDEBUG_IPI_STATS_DUMP:
+		return sbi_ipi_stats_dump(regs->a0);
+	case SBI_EXT_XDEBUG_IPI_STATS_RESET:
+		return sbi_ipi_stats_reset(regs->a0);
+	case SBI_EXT_XDEBUG_ECALL_PROF_SNAPSHOT:
+		/* Only addresses reachable by M-mode are accepted */
+		if (regs->a2)
+			return SBI_EINVALID_ADDR;
+		return sbi_ecall_prof_snapshot(regs->a0, regs->a1,
+					       regs->a3, out_val);
+	case SBI_EXT_XDEBUG_ECALL_PROF_RESET:
+		return sbi_ecall_prof_reset(regs->a0);
+	case SBI_EXT_XDEBUG_TRAP_STATS_READ:
+		return sbi_trap_stats_read(regs->a0, regs->a1,
+					   regs->a2, out_val);
+	case SBI_EXT_XDEBUG_TRAP_STATS_DUMP:
+		return sbi_trap_stats_dump(regs->a0);
+	case SBI_EXT_XDEBUG_TRAP_STATS_RESET:
+		return sbi_trap_stats_reset(regs->a0);
+	default:
+		break;
+	}
+
+	return SBI_ENOTSUPP;
+}
+
+struct sbi_ecall_extension ecall_xdebug = {
+	.extid_start = SBI_EXT_XDEBUG,
+	.extid_end = SBI_EXT_XDEBUG,
+	.handle = sbi_ecall_xdebug_handler,
+};
@@ -0,0 +1,156 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_ecall.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_trap.h>
+
+/* Offset of per-HART multi-call shared memory (zero means not set) */
+static unsigned long xmulti_shmem_off;
+
+static int xmulti_set_shmem(unsigned long lo, unsigned long hi)
+{
+	const struct sbi_domain *dom = sbi_domain_thishart_ptr();
+	unsigned long *shmem =
+			sbi_scratch_thishart_offset_ptr(xmulti_shmem_off);
+
+	if (lo == SBI_XMULTI_SHMEM_DISABLE && hi == SBI_XMULTI_SHMEM_DISABLE) {
+		*shmem = 0;
+		return 0;
+	}
+
+	/* Only addresses reachable by M-mode are accepted */
+	if (hi || !lo || (lo & (SBI_XMULTI_SHMEM_SIZE - 1)))
+		return SBI_EINVALID_ADDR;
+	if (!sbi_domain_check_addr_range(dom, lo, SBI_XMULTI_SHMEM_SIZE, PRV_S,
+					 SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return SBI_EINVALID_ADDR;
+
+	*shmem = lo;
+	return 0;
+}
+
+/*
+ * Only extensions whose calls always return to the caller can be part
+ * of a multi-call. Calls such as HART stop, non-retentive suspend or
+ * system reset never return so the remaining records would be lost.
+ */
+static bool xmulti_extid_allowed(unsigned long extid)
+{
+	switch (extid) {
+	case SBI_EXT_BASE:
+	case SBI_EXT_TIME:
+	case SBI_EXT_IPI:
+	case SBI_EXT_RFENCE:
+	case SBI_EXT_PMU:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static int xmulti_call_one(struct sbi_trap_regs *rregs,
+			   unsigned long *out_val)
+{
+	int ret;
+	struct sbi_trap_info trap = {0};
+	struct sbi_ecall_extension *ext;
+
+	if (!xmulti_extid_allowed(rregs->a7))
+		return SBI_EDENIED;
+
+	ext = sbi_ecall_find_extension(rregs->a7);
+	if (!ext || !ext->handle)
+		return SBI_ENOTSUPP;
+
+	ret = ext->handle(rregs->a7, rregs->a6, rregs, out_val, &trap);
+
+	/*
+	 * A trap taken while accessing S-mode memory can't be redirected
+	 * in the middle of a multi-call so report it as invalid address.
+	 */
+	if (ret == SBI_ETRAP)
+		ret = SBI_EINVALID_ADDR;
+	else if (ret < SBI_LAST_ERR)
+		ret = SBI_EFAIL;
+
+	return ret;
+}
+
+static int xmulti_call(const struct sbi_trap_regs *regs,
+		       unsigned long count, unsigned long *out_val)
+{
+	u32 i;
+	unsigned long *rec, shmem;
+	struct sbi_trap_regs rregs;
+
+	shmem = *((unsigned long *)
+		  sbi_scratch_thishart_offset_ptr(xmulti_shmem_off));
+	if (!shmem)
+		return SBI_EDENIED;
+	if (SBI_XMULTI_MAX_RECORDS < count)
+		return SBI_EINVAL;
+
+	/* Each call sees the register state of the multi-call itself */
+	sbi_memcpy(&rregs, regs, sizeof(rregs));
+
+	for (i = 0; i < count; i++) {
+		rec = (unsigned long *)shmem + i * SBI_XMULTI_REC_WORDS;
+
+		rregs.a7 = rec[SBI_XMULTI_REC_EXTID];
+		rregs.a6 = rec[SBI_XMULTI_REC_FUNCID];
+		rregs.a0 = rec[SBI_XMULTI_REC_ARG(0)];
+		rregs.a1 = rec[SBI_XMULTI_REC_ARG(1)];
+		rregs.a2 = rec[SBI_XMULTI_REC_ARG(2)];
+		rregs.a3 = rec[SBI_XMULTI_REC_ARG(3)];
+		rregs.a4 = rec[SBI_XMULTI_REC_ARG(4)];
+		rregs.a5 = rec[SBI_XMULTI_REC_ARG(5)];
+
+		rec[SBI_XMULTI_REC_VALUE] = 0;
+		rec[SBI_XMULTI_REC_ERROR] =
+			xmulti_call_one(&rregs, &rec[SBI_XMULTI_REC_VALUE]);
+	}
+
+	*out_val = count;
+	return 0;
+}
+
+static int sbi_ecall_xmulti_handler(unsigned long extid, unsigned long funcid,
+				    const struct sbi_trap_regs *regs,
+				    unsigned long *out_val,
+				    struct sbi_trap_info *out_trap)
+{
+	switch (funcid) {
+	case SBI_EXT_XMULTI_SET_SHMEM:
+		return xmulti_set_shmem(regs->a0, regs->a1);
+	case SBI_EXT_XMULTI_CALL:
+		return xmulti_call(regs, regs->a0, out_val);
+	default:
+		break;
+	}
+
+	return SBI_ENOTSUPP;
+}
+
+int sbi_ecall_xmulti_init(void)
+{
+	xmulti_shmem_off = sbi_scratch_alloc_offset(sizeof(unsigned long));
+	if (!xmulti_shmem_off)
+		return SBI_ENOMEM;
+
+	return 0;
+}
+
+struct sbi_ecall_extension ecall_xmulti = {
+	.extid_start = SBI_EXT_XMULTI,
+	.extid_end = SBI_EXT_XMULTI,
+	.handle = sbi_ecall_xmulti_handler,
+};
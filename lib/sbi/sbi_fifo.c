@@ -7,192 +7,216 @@
  *   Atish Patra<atish.patra@wdc.com>
  *
  */
-#include <sbi/riscv_locks.h>
+#include <sbi/riscv_atomic.h>
+#include <sbi/riscv_barrier.h>
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_fifo.h>
 #include <sbi/sbi_string.h>
 
-void sbi_fifo_init(struct sbi_fifo *fifo, void *queue_mem, u16 entries,
-		   u16 entry_size)
+/*
+ * Slot states
+ *
+ * FREE: Slot is empty or reserved by a producer which is still
+ *       copying data into it.
+ * BUSY: Slot is owned by the consumer or by an in-place updater.
+ * FULL: Slot has valid data which is yet to be consumed.
+ */
+#define SBI_FIFO_SLOT_FREE		0
+#define SBI_FIFO_SLOT_BUSY		1
+#define SBI_FIFO_SLOT_FULL		2
+
+static inline void *__sbi_fifo_entry(struct sbi_fifo *fifo, u32 index)
 {
-	fifo->queue	  = queue_mem;
-	fifo->num_entries = entries;
-	fifo->entry_size  = entry_size;
-	SPIN_LOCK_INIT(fifo->qlock);
-	fifo->avail = fifo->tail = 0;
-	sbi_memset(fifo->queue, 0, (size_t)entries * entry_size);
+	return (char *)fifo->queue + index * fifo->entry_size;
 }
 
-/* Note: must be called with fifo->qlock held */
-static inline bool __sbi_fifo_is_full(struct sbi_fifo *fifo)
+static inline u32 __sbi_fifo_index(struct sbi_fifo *fifo, unsigned long pos)
 {
-	return (fifo->avail == fifo->num_entries) ? TRUE : FALSE;
+	return pos % fifo->num_entries;
 }
 
-u16 sbi_fifo_avail(struct sbi_fifo *fifo)
+static inline void __sbi_fifo_copy(struct sbi_fifo *fifo,
+				   void *dst, const void *src)
 {
-	u16 ret;
-
-	if (!fifo)
-		return 0;
-
-	spin_lock(&fifo->qlock);
-	ret = fifo->avail;
-	spin_unlock(&fifo->qlock);
+	u16 i;
+	unsigned long *ldst = dst;
+	const unsigned long *lsrc = src;
+
+	/* Entries are usually word sized and aligned so copy words */
+	if (((unsigned long)dst | (unsigned long)src | fifo->entry_size) &
+	    (sizeof(unsigned long) - 1)) {
+		sbi_memcpy(dst, src, fifo->entry_size);
+		return;
+	}
 
-	return ret;
+	for (i = 0; i < fifo->entry_size / sizeof(unsigned long); i++)
+		ldst[i] = lsrc[i];
 }
 
-int sbi_fifo_is_full(struct sbi_fifo *fifo)
+static inline unsigned long __sbi_fifo_count(struct sbi_fifo *fifo)
 {
-	bool ret;
-
-	if (!fifo)
-		return SBI_EINVAL;
-
-	spin_lock(&fifo->qlock);
-	ret = __sbi_fifo_is_full(fifo);
-	spin_unlock(&fifo->qlock);
-
-	return ret;
+	return atomic_read(&fifo->head) - __smp_load_acquire(&fifo->tail);
 }
 
-/* Note: must be called with fifo->qlock held */
-static inline void  __sbi_fifo_enqueue(struct sbi_fifo *fifo, void *data)
+void sbi_fifo_init(struct sbi_fifo *fifo, void *queue_mem, u16 entries,
+		   u16 entry_size)
 {
-	u32 head;
-
-	head = (u32)fifo->tail + fifo->avail;
-	if (head >= fifo->num_entries)
-		head = head - fifo->num_entries;
-
-	sbi_memcpy((char *)fifo->queue + head * fifo->entry_size, data, fifo->entry_size);
+	size_t queue_size = ROUNDUP((size_t)entries * entry_size,
+				    sizeof(atomic_t));
 
-	fifo->avail++;
+	fifo->queue	  = queue_mem;
+	fifo->slot_state  = (atomic_t *)((char *)queue_mem + queue_size);
+	fifo->num_entries = entries;
+	fifo->entry_size  = entry_size;
+	fifo->tail	  = 0;
+	ATOMIC_INIT(&fifo->head, 0);
+	sbi_memset(fifo->queue, 0,
+		   SBI_FIFO_QUEUE_MEM_SIZE((size_t)entries, entry_size));
 }
 
-
-/* Note: must be called with fifo->qlock held */
-static inline bool __sbi_fifo_is_empty(struct sbi_fifo *fifo)
+u16 sbi_fifo_avail(struct sbi_fifo *fifo)
 {
-	return (fifo->avail == 0) ? TRUE : FALSE;
+	if (!fifo)
+		return 0;
+
+	return __sbi_fifo_count(fifo);
 }
 
-int sbi_fifo_is_empty(struct sbi_fifo *fifo)
+int sbi_fifo_is_full(struct sbi_fifo *fifo)
 {
-	bool ret;
-
 	if (!fifo)
 		return SBI_EINVAL;
 
-	spin_lock(&fifo->qlock);
-	ret = __sbi_fifo_is_empty(fifo);
-	spin_unlock(&fifo->qlock);
-
-	return ret;
+	return (__sbi_fifo_count(fifo) >= fifo->num_entries) ? TRUE : FALSE;
 }
 
-/* Note: must be called with fifo->qlock held */
-static inline void __sbi_fifo_reset(struct sbi_fifo *fifo)
+int sbi_fifo_is_empty(struct sbi_fifo *fifo)
 {
-	size_t size = (size_t)fifo->num_entries * fifo->entry_size;
+	if (!fifo)
+		return SBI_EINVAL;
 
-	fifo->avail = 0;
-	fifo->tail  = 0;
-	sbi_memset(fifo->queue, 0, size);
+	return (__sbi_fifo_count(fifo) == 0) ? TRUE : FALSE;
 }
 
+/* Note: must be called only by the consumer with no producer active */
 bool sbi_fifo_reset(struct sbi_fifo *fifo)
 {
 	if (!fifo)
 		return FALSE;
 
-	spin_lock(&fifo->qlock);
-	__sbi_fifo_reset(fifo);
-	spin_unlock(&fifo->qlock);
+	fifo->tail = 0;
+	ATOMIC_INIT(&fifo->head, 0);
+	sbi_memset(fifo->queue, 0,
+		   SBI_FIFO_QUEUE_MEM_SIZE((size_t)fifo->num_entries,
+					   fifo->entry_size));
+	smp_wmb();
 
 	return TRUE;
 }
 
 /**
  * Provide a helper function to do inplace update to the fifo.
- * Note: The callback function is called with lock being held.
+ * Note: The callback function is called with the fifo entry being
+ * owned by the caller so the consumer can not dequeue it meanwhile.
+ * Entries which are being enqueued or dequeued are skipped.
  *
- * **Do not** invoke any other fifo function from callback. Otherwise, it will
- * lead to deadlock.
+ * **Do not** invoke any other fifo function from callback.
  */
 int sbi_fifo_inplace_update(struct sbi_fifo *fifo, void *in,
 			    int (*fptr)(void *in, void *data))
 {
-	int i, index;
+	u32 index;
+	unsigned long pos, head;
 	int ret = SBI_FIFO_UNCHANGED;
-	void *entry;
 
 	if (!fifo || !in)
 		return ret;
 
-	spin_lock(&fifo->qlock);
+	head = atomic_read(&fifo->head);
+	for (pos = __smp_load_acquire(&fifo->tail); pos < head; pos++) {
+		index = __sbi_fifo_index(fifo, pos);
+		if (atomic_cmpxchg(&fifo->slot_state[index],
+				   SBI_FIFO_SLOT_FULL,
+				   SBI_FIFO_SLOT_BUSY) != SBI_FIFO_SLOT_FULL)
+			continue;
 
-	if (__sbi_fifo_is_empty(fifo)) {
-		spin_unlock(&fifo->qlock);
-		return ret;
-	}
+		ret = fptr(in, __sbi_fifo_entry(fifo, index));
 
-	for (i = 0; i < fifo->avail; i++) {
-		index = fifo->tail + i;
-		if (index >= fifo->num_entries)
-			index -= fifo->num_entries;
-		entry = (char *)fifo->queue + (u32)index * fifo->entry_size;
-		ret = fptr(in, entry);
+		__smp_store_release(&fifo->slot_state[index].counter,
+				    SBI_FIFO_SLOT_FULL);
 
-		if (ret == SBI_FIFO_SKIP || ret == SBI_FIFO_UPDATED) {
+		if (ret == SBI_FIFO_SKIP || ret == SBI_FIFO_UPDATED)
 			break;
-		}
 	}
-	spin_unlock(&fifo->qlock);
 
 	return ret;
 }
 
 int sbi_fifo_enqueue(struct sbi_fifo *fifo, void *data)
 {
+	u32 index;
+	long head, tail;
+
 	if (!fifo || !data)
 		return SBI_EINVAL;
 
-	spin_lock(&fifo->qlock);
-
-	if (__sbi_fifo_is_full(fifo)) {
-		spin_unlock(&fifo->qlock);
-		return SBI_ENOSPC;
-	}
-	__sbi_fifo_enqueue(fifo, data);
-
-	spin_unlock(&fifo->qlock);
+	/* Reserve a slot by moving the head forward */
+	do {
+		head = atomic_read(&fifo->head);
+		tail = __smp_load_acquire(&fifo->tail);
+		if ((head - tail) >= fifo->num_entries)
+			return SBI_ENOSPC;
+	} while (atomic_cmpxchg(&fifo->head, head, head + 1) != head);
+
+	/*
+	 * The consumer marks a slot free before moving the tail so
+	 * the reserved slot is guaranteed to be free at this point.
+	 */
+	index = __sbi_fifo_index(fifo, head);
+	__sbi_fifo_copy(fifo, __sbi_fifo_entry(fifo, index), data);
+
+	/* Publish the slot to the consumer */
+	__smp_store_release(&fifo->slot_state[index].counter,
+			    SBI_FIFO_SLOT_FULL);
 
 	return 0;
 }
 
+/* Note: must be called only by the consumer (i.e. owner) of the fifo */
 int sbi_fifo_dequeue(struct sbi_fifo *fifo, void *data)
 {
+	u32 index;
+	long state;
+	unsigned long tail;
+
 	if (!fifo || !data)
 		return SBI_EINVAL;
 
-	spin_lock(&fifo->qlock);
-
-	if (__sbi_fifo_is_empty(fifo)) {
-		spin_unlock(&fifo->qlock);
+	tail = fifo->tail;
+	if (tail == atomic_read(&fifo->head))
 		return SBI_ENOENT;
-	}
 
-	sbi_memcpy(data, (char *)fifo->queue + (u32)fifo->tail * fifo->entry_size,
-	       fifo->entry_size);
+	index = __sbi_fifo_index(fifo, tail);
+	while ((state = atomic_cmpxchg(&fifo->slot_state[index],
+				       SBI_FIFO_SLOT_FULL,
+				       SBI_FIFO_SLOT_BUSY)) != SBI_FIFO_SLOT_FULL) {
+		/*
+		 * Producer has reserved the slot but not yet published
+		 * it so treat the fifo as empty for now. The producer
+		 * will send an IPI after publishing.
+		 */
+		if (state == SBI_FIFO_SLOT_FREE)
+			return SBI_ENOENT;
+
+		/* In-place update is in progress so wait for it */
+		cpu_relax();
+	}
 
-	fifo->avail--;
-	fifo->tail++;
-	if (fifo->tail >= fifo->num_entries)
-		fifo->tail = 0;
+	__sbi_fifo_copy(fifo, data, __sbi_fifo_entry(fifo, index));
 
-	spin_unlock(&fifo->qlock);
+	__smp_store_release(&fifo->slot_state[index].counter,
+			    SBI_FIFO_SLOT_FREE);
+	__smp_store_release(&fifo->tail, tail + 1);
 
 	return 0;
 }
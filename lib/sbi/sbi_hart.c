@@ -434,6 +434,9 @@ static inline char *sbi_hart_extension_id2string(int ext)
 	case SBI_HART_EXT_SMSTATEEN:
 		estr = "smstateen";
 		break;
+	case SBI_HART_EXT_SVINVAL:
+		estr = "svinval";
+		break;
 	default:
 		break;
 	}
@@ -536,6 +539,26 @@ static int hart_pmu_get_allowed_bits(void)
 	return num_bits;
 }
 
+/* Execute SFENCE.W.INVAL and report trap (if any) in trap info */
+static void hart_probe_sfence_w_inval(struct sbi_trap_info *trap)
+{
+	register ulong tinfo asm("a3") = (ulong)trap;
+	register ulong ttmp asm("a4");
+	register ulong mtvec = sbi_hart_expected_trap_addr();
+
+	trap->cause = 0;
+	asm volatile(
+		"add %[ttmp], %[tinfo], zero\n"
+		"csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n"
+		/* SFENCE.W.INVAL */
+		".word 0x18000073\n"
+		"csrw " STR(CSR_MTVEC) ", %[mtvec]"
+	    : [mtvec] "+&r"(mtvec), [tinfo] "+&r"(tinfo),
+	      [ttmp] "+&r"(ttmp)
+	    :
+	    : "memory");
+}
+
 static int hart_detect_features(struct sbi_scratch *scratch)
 {
 	struct sbi_trap_info trap = {0};
@@ -681,6 +704,14 @@ __mhpm_skip:
 					SBI_HART_EXT_SMSTATEEN, true);
 	}
 
+	/* Detect if hart supports Svinval instructions */
+	if (misa_extension('S')) {
+		hart_probe_sfence_w_inval(&trap);
+		if (!trap.cause)
+			__sbi_hart_update_extension(hfeatures,
+					SBI_HART_EXT_SVINVAL, true);
+	}
+
 	/* Let platform populate extensions */
 	rc = sbi_platform_extensions_init(sbi_platform_thishart_ptr());
 	if (rc)
@@ -29,6 +29,9 @@
 static const struct sbi_hsm_device *hsm_dev = NULL;
 static unsigned long hart_data_offset;
 
+/* HARTs in STARTED or SUSPENDED state which can receive IPIs */
+static struct sbi_hartmask hsm_interruptible_harts;
+
 /** Per hart specific data to manage state transition **/
 struct sbi_hsm_data {
 	atomic_t state;
@@ -58,6 +61,35 @@ int sbi_hsm_hart_get_state(const struct sbi_domain *dom, u32 hartid)
 	return __sbi_hsm_hart_get_state(hartid);
 }
 
+static void hsm_set_interruptible(u32 hartid, bool interruptible)
+{
+	if (SBI_HARTMASK_MAX_BITS <= hartid)
+		return;
+
+	if (interruptible)
+		atomic_raw_set_bit(hartid, hsm_interruptible_harts.bits);
+	else
+		atomic_raw_clear_bit(hartid, hsm_interruptible_harts.bits);
+}
+
+static ulong hsm_interruptible_word(ulong hbase)
+{
+	ulong ret, bword, boff;
+	const ulong *bits = sbi_hartmask_bits(&hsm_interruptible_harts);
+
+	bword = BIT_WORD(hbase);
+	boff = BIT_WORD_OFFSET(hbase);
+	if (BIT_WORD(SBI_HARTMASK_MAX_BITS) <= bword)
+		return 0;
+
+	ret = bits[bword++] >> boff;
+	if (boff && bword < BIT_WORD(SBI_HARTMASK_MAX_BITS))
+		ret |= (bits[bword] & (BIT(boff) - 1UL)) <<
+			(BITS_PER_LONG - boff);
+
+	return ret;
+}
+
 /**
  * Get ulong HART mask for given HART base ID
  * @param dom the domain to be used for output HART mask
@@ -69,26 +101,34 @@ int sbi_hsm_hart_get_state(const struct sbi_domain *dom, u32 hartid)
 int sbi_hsm_hart_interruptible_mask(const struct sbi_domain *dom,
 				    ulong hbase, ulong *out_hmask)
 {
-	int hstate;
-	ulong i, hmask, dmask;
 	ulong hend = sbi_scratch_last_hartid() + 1;
 
 	*out_hmask = 0;
 	if (hend <= hbase)
 		return SBI_EINVAL;
-	if (BITS_PER_LONG < (hend - hbase))
-		hend = hbase + BITS_PER_LONG;
-
-	dmask = sbi_domain_get_assigned_hartmask(dom, hbase);
-	for (i = hbase; i < hend; i++) {
-		hmask = 1UL << (i - hbase);
-		if (dmask & hmask) {
-			hstate = __sbi_hsm_hart_get_state(i);
-			if (hstate == SBI_HSM_STATE_STARTED ||
-			    hstate == SBI_HSM_STATE_SUSPENDED)
-				*out_hmask |= hmask;
-		}
-	}
+
+	*out_hmask = sbi_domain_get_assigned_hartmask(dom, hbase) &
+		     hsm_interruptible_word(hbase);
+
+	return 0;
+}
+
+/**
+ * Get full HART mask of interruptible HARTs
+ * @param dom the domain to be used for output HART mask
+ * @param out_hmask the output HART mask
+ * @return 0 on success and SBI_Exxx (< 0) on failure
+ * Note: the output HART mask will be set to zero on failure as well.
+ */
+int sbi_hsm_hart_interruptible_hartmask(const struct sbi_domain *dom,
+					struct sbi_hartmask *out_hmask)
+{
+	sbi_hartmask_clear_all(out_hmask);
+	if (!dom)
+		return SBI_EINVAL;
+
+	sbi_hartmask_and(out_hmask, &dom->assigned_harts,
+			 &hsm_interruptible_harts);
 
 	return 0;
 }
@@ -103,6 +143,8 @@ void sbi_hsm_prepare_next_jump(struct sbi_scratch *scratch, u32 hartid)
 				  SBI_HSM_STATE_STARTED);
 	if (oldstate != SBI_HSM_STATE_START_PENDING)
 		sbi_hart_hang();
+
+	hsm_set_interruptible(hartid, TRUE);
 }
 
 static void sbi_hsm_hart_wait(struct sbi_scratch *scratch, u32 hartid)
@@ -208,6 +250,7 @@ int sbi_hsm_init(struct sbi_scratch *scratch, u32 hartid, bool cold_boot)
 				    SBI_HSM_STATE_START_PENDING :
 				    SBI_HSM_STATE_STOPPED);
 		}
+		sbi_hartmask_clear_all(&hsm_interruptible_harts);
 	} else {
 		sbi_hsm_hart_wait(scratch, hartid);
 	}
@@ -314,6 +357,7 @@ int sbi_hsm_hart_stop(struct sbi_scratch *scratch, bool exitnow)
 			   __func__, oldstate);
 		return SBI_EFAIL;
 	}
+	hsm_set_interruptible(current_hartid(), FALSE);
 
 	if (exitnow)
 		sbi_exit(scratch);
@@ -375,6 +419,7 @@ void sbi_hsm_hart_resume_start(struct sbi_scratch *scratch)
 			   __func__, oldstate);
 		sbi_hart_hang();
 	}
+	hsm_set_interruptible(current_hartid(), FALSE);
 
 	hsm_device_hart_resume();
 }
@@ -393,6 +438,7 @@ void sbi_hsm_hart_resume_finish(struct sbi_scratch *scratch)
 			   __func__, oldstate);
 		sbi_hart_hang();
 	}
+	hsm_set_interruptible(current_hartid(), TRUE);
 
 	/*
 	 * Restore some of the M-mode CSRs which we are re-configured by
@@ -25,6 +25,7 @@
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_timer.h>
 #include <sbi/sbi_tlb.h>
+#include <sbi/sbi_trap.h>
 #include <sbi/sbi_version.h>
 
 #define BANNER                                              \
@@ -153,6 +154,10 @@ static void sbi_boot_print_hart(struct sbi_scratch *scratch, u32 hartid)
 		   sbi_hart_pmp_addrbits(scratch));
 	sbi_printf("Boot HART MHPM Count      : %d\n",
 		   sbi_hart_mhpm_count(scratch));
+	sbi_printf("Boot HART TLBR Flush Limit: %lu (%s)\n",
+		   sbi_tlb_range_flush_limit(scratch),
+		   sbi_tlb_range_flush_limit_calibrated() ?
+		   "calibrated" : "platform");
 	sbi_hart_delegation_dump(scratch, "Boot HART ", "         ");
 }
 
@@ -267,6 +272,10 @@ static void __noreturn init_coldboot(struct sbi_scratch *scratch, u32 hartid)
 	if (rc)
 		sbi_hart_hang();
 
+	rc = sbi_trap_stats_init(scratch, TRUE);
+	if (rc)
+		sbi_hart_hang();
+
 	rc = sbi_pmu_init(scratch, TRUE);
 	if (rc)
 		sbi_hart_hang();
@@ -372,6 +381,10 @@ static void init_warm_startup(struct sbi_scratch *scratch, u32 hartid)
 	if (rc)
 		sbi_hart_hang();
 
+	rc = sbi_trap_stats_init(scratch, FALSE);
+	if (rc)
+		sbi_hart_hang();
+
 	rc = sbi_pmu_init(scratch, FALSE);
 	if (rc)
 		sbi_hart_hang();
@@ -416,6 +429,10 @@ static void init_warm_resume(struct sbi_scratch *scratch)
 	if (rc)
 		sbi_hart_hang();
 
+	rc = sbi_trap_stats_init(scratch, FALSE);
+	if (rc)
+		sbi_hart_hang();
+
 	rc = sbi_hart_pmp_configure(scratch);
 	if (rc)
 		sbi_hart_hang();
@@ -545,6 +562,9 @@ void __noreturn sbi_exit(struct sbi_scratch *scratch)
 	if (sbi_platform_hart_invalid(plat, hartid))
 		sbi_hart_hang();
 
+	sbi_ecall_prof_dump(scratch);
+	sbi_trap_stats_dump(hartid);
+
 	sbi_platform_early_exit(plat);
 
 	sbi_pmu_exit(scratch);
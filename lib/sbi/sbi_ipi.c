@@ -12,7 +12,9 @@
 #include <sbi/riscv_atomic.h>
 #include <sbi/riscv_barrier.h>
 #include <sbi/sbi_bitops.h>
+#include <sbi/sbi_console.h>
 #include <sbi/sbi_domain.h>
+#include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_hsm.h>
@@ -21,28 +23,79 @@
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_pmu.h>
 #include <sbi/sbi_string.h>
+#include <sbi/sbi_timer.h>
 #include <sbi/sbi_tlb.h>
 
+/** Per-event IPI statistics of a HART */
+struct sbi_ipi_stats {
+	/** IPIs sent by this HART */
+	u32 sent;
+	/** IPIs processed by this HART */
+	u32 recvd;
+	/** IPIs sent by this HART without triggering an interrupt */
+	u32 coalesced;
+	/** Log2 histogram of send-to-process latency in timer ticks */
+	u32 lat_hist[SBI_IPI_STATS_LAT_BUCKETS];
+};
+
 struct sbi_ipi_data {
 	unsigned long ipi_type;
+	/** HARTs to which this HART forwards IPIs (tree broadcast) */
+	struct sbi_hartmask ipi_fwd;
+	/** Time at which each IPI event was made pending */
+	u64 ipi_stamp[SBI_IPI_STATS_EVENT_MAX];
+	/** IPI statistics of this HART */
+	struct sbi_ipi_stats stats[SBI_IPI_STATS_EVENT_MAX];
 };
 
 static unsigned long ipi_data_off;
 static const struct sbi_ipi_device *ipi_dev = NULL;
 static const struct sbi_ipi_event_ops *ipi_ops_array[SBI_IPI_EVENT_MAX];
 
-static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartid,
-			u32 event, void *data)
+/*
+ * Pending IPI events are processed in the order of their event number
+ * so the event numbers are divided into bands, one for each priority.
+ */
+#define IPI_EVENT_PRIO_BITS	(SBI_IPI_EVENT_MAX / SBI_IPI_EVENT_PRIO_MAX)
+
+/* Statistics slot plus one of each IPI event (zero means no statistics) */
+static u8 ipi_stats_slot[SBI_IPI_EVENT_MAX];
+static u32 ipi_stats_slot_count;
+
+/* Cluster of each HART used for tree broadcast of IPIs */
+static bool ipi_tree_enabled;
+static u32 ipi_hart_cluster[SBI_HARTMASK_MAX_BITS];
+
+static inline u32 sbi_ipi_stats_slot(u32 event)
+{
+	if (SBI_IPI_EVENT_MAX <= event || !ipi_stats_slot[event])
+		return SBI_IPI_STATS_EVENT_MAX;
+
+	return ipi_stats_slot[event] - 1;
+}
+
+static struct sbi_ipi_stats *sbi_ipi_stats_ptr(struct sbi_scratch *scratch,
+					       u32 event)
+{
+	struct sbi_ipi_data *ipi_data;
+	u32 slot = sbi_ipi_stats_slot(event);
+
+	if (SBI_IPI_STATS_EVENT_MAX <= slot)
+		return NULL;
+
+	ipi_data = sbi_scratch_offset_ptr(scratch, ipi_data_off);
+	return &ipi_data->stats[slot];
+}
+
+static int sbi_ipi_update(struct sbi_scratch *scratch, u32 remote_hartid,
+			  const struct sbi_ipi_event_ops *ipi_ops,
+			  u32 event, void *data, u64 stamp)
 {
 	int ret;
+	u32 slot;
+	struct sbi_ipi_stats *stats;
 	struct sbi_scratch *remote_scratch = NULL;
 	struct sbi_ipi_data *ipi_data;
-	const struct sbi_ipi_event_ops *ipi_ops;
-
-	if ((SBI_IPI_EVENT_MAX <= event) ||
-	    !ipi_ops_array[event])
-		return SBI_EINVAL;
-	ipi_ops = ipi_ops_array[event];
 
 	remote_scratch = sbi_hartid_to_scratch(remote_hartid);
 	if (!remote_scratch)
@@ -58,19 +111,232 @@ static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartid,
 	}
 
 	/*
-	 * Set IPI type on remote hart's scratch area and
-	 * trigger the interrupt
+	 * Save the time at which IPI event became pending. If the event
+	 * is already pending then keep the older time. The AMO below
+	 * orders this store before setting the IPI type.
+	 */
+	slot = sbi_ipi_stats_slot(event);
+	if (slot < SBI_IPI_STATS_EVENT_MAX &&
+	    !(ipi_data->ipi_type & (1UL << event)))
+		ipi_data->ipi_stamp[slot] = stamp;
+
+	/*
+	 * Set IPI type on remote hart's scratch area. If some other IPI
+	 * type was already pending then the remote hart has not consumed
+	 * it yet and its doorbell was either rung already or is queued in
+	 * the forward mask of a delegate so there is no need to trigger
+	 * it again. Delegates drain their forward mask from every M-mode
+	 * wait loop so a queued doorbell can not be held back by a sync.
 	 */
+	if (atomic_raw_or_ulong(&ipi_data->ipi_type, 1UL << event)) {
+		stats = sbi_ipi_stats_ptr(scratch, event);
+		if (stats)
+			stats->coalesced++;
+		return 1;
+	}
+
+	return 0;
+}
+
+static void sbi_ipi_trigger(struct sbi_hartmask *targets)
+{
+	u32 i;
+
+	if (!ipi_dev)
+		return;
+
+	if (ipi_dev->ipi_send_mask) {
+		ipi_dev->ipi_send_mask(targets);
+	} else if (ipi_dev->ipi_send) {
+		sbi_hartmask_for_each_hart(i, targets)
+			ipi_dev->ipi_send(i);
+	}
+}
+
+/*
+ * Trigger IPIs using a two level tree where the first target of each
+ * cluster acts as delegate and forwards the IPI to remaining targets
+ * of its cluster. The IPI types of all targets are already set by the
+ * calling HART so the delegate only rings the doorbells.
+ */
+static void sbi_ipi_tree_trigger(struct sbi_hartmask *targets)
+{
+	u32 i, j;
+	struct sbi_hartmask pending, direct;
+	struct sbi_scratch *dscratch;
+	struct sbi_ipi_data *dipi_data;
+
+	sbi_hartmask_clear_all(&direct);
+	pending = *targets;
+
+	sbi_hartmask_for_each_hart(i, targets) {
+		if (!sbi_hartmask_test_hart(i, &pending))
+			continue;
+		sbi_hartmask_clear_hart(i, &pending);
+		sbi_hartmask_set_hart(i, &direct);
+
+		dscratch = sbi_hartid_to_scratch(i);
+		if (!dscratch)
+			continue;
+		dipi_data = sbi_scratch_offset_ptr(dscratch, ipi_data_off);
+
+		sbi_hartmask_for_each_hart(j, &pending) {
+			if (ipi_hart_cluster[j] != ipi_hart_cluster[i])
+				continue;
+			sbi_hartmask_clear_hart(j, &pending);
+			atomic_raw_set_bit(j, dipi_data->ipi_fwd.bits);
+		}
+	}
+
+	/* Make forward masks visible before triggering the delegates */
+	smp_wmb();
+
+	sbi_ipi_trigger(&direct);
+}
+
+static void sbi_ipi_forward(struct sbi_ipi_data *ipi_data)
+{
+	u32 i;
+	unsigned long fwd = 0;
+	struct sbi_hartmask targets;
+
+	for (i = 0; i < BITS_TO_LONGS(SBI_HARTMASK_MAX_BITS); i++) {
+		/* Avoid the AMO when nothing is queued for this word */
+		if (!ipi_data->ipi_fwd.bits[i]) {
+			targets.bits[i] = 0;
+			continue;
+		}
+		targets.bits[i] = atomic_raw_xchg_ulong(
+					&ipi_data->ipi_fwd.bits[i], 0);
+		fwd |= targets.bits[i];
+	}
+
+	if (fwd)
+		sbi_ipi_trigger(&targets);
+}
+
+/**
+ * Ring the doorbells queued for this HART as a delegate.
+ *
+ * A delegate which spins in M-mode waiting for other HARTs must call
+ * this from its wait loop so that its cluster is not held back until
+ * the delegate processes its own IPI.
+ */
+void sbi_ipi_forward_pending(void)
+{
+	if (!ipi_tree_enabled)
+		return;
+
+	sbi_ipi_forward(sbi_scratch_thishart_offset_ptr(ipi_data_off));
+}
+
+/**
+ * Mark an IPI event pending on a HART without triggering the IPI.
+ *
+ * The event is processed along with the next IPI taken by the HART.
+ * This is meant for low priority notifications which must not send
+ * IPIs while processing IPIs.
+ */
+int sbi_ipi_set_pending(u32 hartid, u32 event)
+{
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+	struct sbi_ipi_data *ipi_data;
+
+	if (!scratch || SBI_IPI_EVENT_MAX <= event || !ipi_ops_array[event])
+		return SBI_EINVAL;
+
+	ipi_data = sbi_scratch_offset_ptr(scratch, ipi_data_off);
 	atomic_raw_set_bit(event, &ipi_data->ipi_type);
+
+	return 0;
+}
+
+int sbi_ipi_set_cluster(u32 hartid, u32 cluster)
+{
+	if (SBI_HARTMASK_MAX_BITS <= hartid)
+		return SBI_EINVAL;
+
+	ipi_hart_cluster[hartid] = cluster;
+	ipi_tree_enabled = TRUE;
+
+	return 0;
+}
+
+/**
+ * Send IPIs to all interruptible HARTs of the current domain which are
+ * set in the given HART mask.
+ *
+ * The update callback is called for all targets first, then the IPIs are
+ * triggered at once and finally the sync callback is called for each target.
+ * The HART mask is walked one word at a time using find-first-set so the
+ * cost scales with number of targets rather than with the HART id range.
+ */
+int sbi_ipi_send_hartmask(const struct sbi_hartmask *hmask,
+			  u32 event, void *data)
+{
+	int rc;
+	u64 stamp;
+	u32 i, w, count = 0;
+	unsigned long bits;
+	struct sbi_ipi_stats *stats;
+	struct sbi_hartmask m, targets;
+	const struct sbi_ipi_event_ops *ipi_ops;
+	struct sbi_domain *dom = sbi_domain_thishart_ptr();
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+
+	if ((SBI_IPI_EVENT_MAX <= event) ||
+	    !ipi_ops_array[event] || !hmask)
+		return SBI_EINVAL;
+	ipi_ops = ipi_ops_array[event];
+
+	rc = sbi_hsm_hart_interruptible_hartmask(dom, &m);
+	if (rc)
+		return rc;
+	sbi_hartmask_and(&m, &m, hmask);
+
+	/* Update targets */
+	stamp = sbi_timer_value();
+	sbi_hartmask_clear_all(&targets);
+	for (w = 0; w < BITS_TO_LONGS(SBI_HARTMASK_MAX_BITS); w++) {
+		bits = sbi_hartmask_bits(&m)[w];
+		while (bits) {
+			i = w * BITS_PER_LONG + sbi_ffs(bits);
+			bits &= bits - 1;
+
+			rc = sbi_ipi_update(scratch, i, ipi_ops,
+					    event, data, stamp);
+			if (rc < 0)
+				continue;
+			if (!rc)
+				sbi_hartmask_set_hart(i, &targets);
+			count++;
+		}
+	}
+
+	/* Make IPI types visible before triggering the interrupts */
 	smp_wmb();
 
-	if (ipi_dev && ipi_dev->ipi_send)
-		ipi_dev->ipi_send(remote_hartid);
+	if (ipi_tree_enabled)
+		sbi_ipi_tree_trigger(&targets);
+	else
+		sbi_ipi_trigger(&targets);
 
-	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_SENT);
+	stats = sbi_ipi_stats_ptr(scratch, event);
+	if (stats)
+		stats->sent += count;
+
+	/*
+	 * A coalesced target may rely on a doorbell queued for this HART
+	 * as delegate so ring those before waiting for the targets.
+	 */
+	if (count && ipi_ops->sync)
+		sbi_ipi_forward_pending();
 
-	if (ipi_ops->sync)
-		ipi_ops->sync(scratch);
+	for (i = 0; i < count; i++) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_SENT);
+		if (ipi_ops->sync)
+			ipi_ops->sync(scratch);
+	}
 
 	return 0;
 }
@@ -82,45 +348,39 @@ static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartid,
  */
 int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 {
-	int rc;
-	ulong i, m;
-	struct sbi_domain *dom = sbi_domain_thishart_ptr();
-	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct sbi_hartmask m;
 
 	if (hbase != -1UL) {
-		rc = sbi_hsm_hart_interruptible_mask(dom, hbase, &m);
-		if (rc)
-			return rc;
-		m &= hmask;
-
-		/* Send IPIs */
-		for (i = hbase; m; i++, m >>= 1) {
-			if (m & 1UL)
-				sbi_ipi_send(scratch, i, event, data);
+		if (sbi_scratch_last_hartid() < hbase)
+			return SBI_EINVAL;
+
+		sbi_hartmask_clear_all(&m);
+		while (hmask) {
+			sbi_hartmask_set_hart(hbase + sbi_ffs(hmask), &m);
+			hmask &= hmask - 1;
 		}
 	} else {
-		hbase = 0;
-		while (!sbi_hsm_hart_interruptible_mask(dom, hbase, &m)) {
-			/* Send IPIs */
-			for (i = hbase; m; i++, m >>= 1) {
-				if (m & 1UL)
-					sbi_ipi_send(scratch, i, event, data);
-			}
-			hbase += BITS_PER_LONG;
-		}
+		sbi_hartmask_set_all(&m);
 	}
 
-	return 0;
+	return sbi_ipi_send_hartmask(&m, event, data);
 }
 
-int sbi_ipi_event_create(const struct sbi_ipi_event_ops *ops)
+/**
+ * Create an IPI event with given priority
+ *
+ * The event number is allocated from the band of event numbers of given
+ * priority. When the band is full, the event number is allocated from the
+ * bands of lower priorities.
+ */
+int sbi_ipi_event_create(const struct sbi_ipi_event_ops *ops, u32 prio)
 {
 	int i, ret = SBI_ENOSPC;
 
-	if (!ops || !ops->process)
+	if (!ops || !ops->process || SBI_IPI_EVENT_PRIO_MAX <= prio)
 		return SBI_EINVAL;
 
-	for (i = 0; i < SBI_IPI_EVENT_MAX; i++) {
+	for (i = prio * IPI_EVENT_PRIO_BITS; i < SBI_IPI_EVENT_MAX; i++) {
 		if (!ipi_ops_array[i]) {
 			ret = i;
 			ipi_ops_array[i] = ops;
@@ -128,6 +388,9 @@ int sbi_ipi_event_create(const struct sbi_ipi_event_ops *ops)
 		}
 	}
 
+	if (0 <= ret && ipi_stats_slot_count < SBI_IPI_STATS_EVENT_MAX)
+		ipi_stats_slot[ret] = ++ipi_stats_slot_count;
+
 	return ret;
 }
 
@@ -137,6 +400,7 @@ void sbi_ipi_event_destroy(u32 event)
 		return;
 
 	ipi_ops_array[event] = NULL;
+	ipi_stats_slot[event] = 0;
 }
 
 static void sbi_ipi_process_smode(struct sbi_scratch *scratch)
@@ -178,8 +442,34 @@ int sbi_ipi_send_halt(ulong hmask, ulong hbase)
 	return sbi_ipi_send_many(hmask, hbase, ipi_halt_event, NULL);
 }
 
+static void sbi_ipi_stats_process(struct sbi_ipi_data *ipi_data,
+				  u32 event, u64 now)
+{
+	u64 lat;
+	u32 bucket, slot = sbi_ipi_stats_slot(event);
+	struct sbi_ipi_stats *stats;
+
+	if (SBI_IPI_STATS_EVENT_MAX <= slot)
+		return;
+	stats = &ipi_data->stats[slot];
+
+	stats->recvd++;
+
+	if (!ipi_data->ipi_stamp[slot] || now < ipi_data->ipi_stamp[slot])
+		return;
+	lat = now - ipi_data->ipi_stamp[slot];
+
+	bucket = 0;
+	while (lat && bucket < (SBI_IPI_STATS_LAT_BUCKETS - 1)) {
+		lat >>= 1;
+		bucket++;
+	}
+	stats->lat_hist[bucket]++;
+}
+
 void sbi_ipi_process(void)
 {
+	u64 now;
 	unsigned long ipi_type;
 	unsigned int ipi_event;
 	const struct sbi_ipi_event_ops *ipi_ops;
@@ -192,20 +482,106 @@ void sbi_ipi_process(void)
 	if (ipi_dev && ipi_dev->ipi_clear)
 		ipi_dev->ipi_clear(hartid);
 
+	/*
+	 * Senders skip triggering the interrupt when some IPI type is
+	 * already pending so the interrupt must be cleared before taking
+	 * the IPI types. Otherwise, an IPI type set after taking the IPI
+	 * types could lose its interrupt.
+	 */
+	mb();
+
+	/* Forward IPIs to other HARTs of our cluster before processing */
+	if (ipi_tree_enabled)
+		sbi_ipi_forward(ipi_data);
+
 	ipi_type = atomic_raw_xchg_ulong(&ipi_data->ipi_type, 0);
-	ipi_event = 0;
+	now = sbi_timer_value();
+
+	/* Lower event numbers have higher priority */
 	while (ipi_type) {
-		if (!(ipi_type & 1UL))
-			goto skip;
+		ipi_event = sbi_ffs(ipi_type);
+		ipi_type &= ipi_type - 1;
+
+		sbi_ipi_stats_process(ipi_data, ipi_event, now);
 
 		ipi_ops = ipi_ops_array[ipi_event];
 		if (ipi_ops && ipi_ops->process)
 			ipi_ops->process(scratch);
+	}
+}
+
+int sbi_ipi_stats_read(u32 hartid, u32 event, unsigned long stat,
+		       unsigned long *out_val)
+{
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+	struct sbi_ipi_stats *stats;
+
+	if (!scratch || !out_val)
+		return SBI_EINVAL;
+	stats = sbi_ipi_stats_ptr(scratch, event);
+	if (!stats)
+		return SBI_EINVAL;
+
+	switch (stat) {
+	case SBI_XDEBUG_IPI_STAT_SENT:
+		*out_val = stats->sent;
+		break;
+	case SBI_XDEBUG_IPI_STAT_RECVD:
+		*out_val = stats->recvd;
+		break;
+	case SBI_XDEBUG_IPI_STAT_COALESCED:
+		*out_val = stats->coalesced;
+		break;
+	default:
+		stat -= SBI_XDEBUG_IPI_STAT_LAT_HIST(0);
+		if (SBI_IPI_STATS_LAT_BUCKETS <= stat)
+			return SBI_EINVAL;
+		*out_val = stats->lat_hist[stat];
+		break;
+	}
 
-skip:
-		ipi_type = ipi_type >> 1;
-		ipi_event++;
-	};
+	return 0;
+}
+
+int sbi_ipi_stats_reset(u32 hartid)
+{
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+	struct sbi_ipi_data *ipi_data;
+
+	if (!scratch)
+		return SBI_EINVAL;
+
+	ipi_data = sbi_scratch_offset_ptr(scratch, ipi_data_off);
+	sbi_memset(ipi_data->stats, 0, sizeof(ipi_data->stats));
+
+	return 0;
+}
+
+int sbi_ipi_stats_dump(u32 hartid)
+{
+	u32 i, j;
+	struct sbi_ipi_stats *stats;
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+
+	if (!scratch)
+		return SBI_EINVAL;
+
+	for (i = 0; i < SBI_IPI_EVENT_MAX; i++) {
+		stats = sbi_ipi_stats_ptr(scratch, i);
+		if (!ipi_ops_array[i] || !stats)
+			continue;
+
+		sbi_printf("HART%u %-16s: sent=%u recvd=%u coalesced=%u\n",
+			   hartid, ipi_ops_array[i]->name, stats->sent,
+			   stats->recvd, stats->coalesced);
+		sbi_printf("HART%u %-16s: latency log2 histogram:",
+			   hartid, ipi_ops_array[i]->name);
+		for (j = 0; j < SBI_IPI_STATS_LAT_BUCKETS; j++)
+			sbi_printf(" %u", stats->lat_hist[j]);
+		sbi_printf("\n");
+	}
+
+	return 0;
 }
 
 int sbi_ipi_raw_send(u32 target_hart)
@@ -239,11 +615,14 @@ int sbi_ipi_init(struct sbi_scratch *scratch, bool cold_boot)
 		ipi_data_off = sbi_scratch_alloc_offset(sizeof(*ipi_data));
 		if (!ipi_data_off)
 			return SBI_ENOMEM;
-		ret = sbi_ipi_event_create(&ipi_smode_ops);
+		ret = sbi_ipi_event_create(&ipi_smode_ops,
+					   SBI_IPI_EVENT_PRIO_NORMAL);
 		if (ret < 0)
 			return ret;
 		ipi_smode_event = ret;
-		ret = sbi_ipi_event_create(&ipi_halt_ops);
+		/* Process other pending events before halting */
+		ret = sbi_ipi_event_create(&ipi_halt_ops,
+					   SBI_IPI_EVENT_PRIO_LOW);
 		if (ret < 0)
 			return ret;
 		ipi_halt_event = ret;
@@ -257,6 +636,7 @@ int sbi_ipi_init(struct sbi_scratch *scratch, bool cold_boot)
 
 	ipi_data = sbi_scratch_offset_ptr(scratch, ipi_data_off);
 	ipi_data->ipi_type = 0x00;
+	sbi_hartmask_clear_all(&ipi_data->ipi_fwd);
 
 	/*
 	 * Initialize platform IPI support. This will also clear any
@@ -10,6 +10,8 @@
 #include <sbi/riscv_asm.h>
 #include <sbi/sbi_bitops.h>
 #include <sbi/sbi_console.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_error.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_pmu.h>
@@ -60,6 +62,15 @@ union sbi_pmu_ctr_info {
 	};
 };
 
+/** Layout of the PMU snapshot shared memory */
+struct sbi_pmu_snapshot {
+	/* Overflow bitmap of the counters stopped with snapshot */
+	uint64_t ctr_overflow_mask;
+
+	/* Counter values relative to the counter base */
+	uint64_t ctr_values[SBI_PMU_SNAPSHOT_CTR_MAX];
+};
+
 /* Mapping between event range and possible counters  */
 static struct sbi_pmu_hw_event hw_event_map[SBI_PMU_HW_EVENT_MAX] = {0};
 
@@ -69,6 +80,12 @@ static uint32_t active_events[SBI_HARTMASK_MAX_BITS][SBI_PMU_HW_CTR_MAX + SBI_PM
 /* Contains all the information about firmwares events */
 static struct sbi_pmu_fw_event fw_event_map[SBI_HARTMASK_MAX_BITS][SBI_PMU_FW_EVENT_MAX] = {0};
 
+/*
+ * Offset of per-HART snapshot shared memory address registered by
+ * supervisor mode (address is 0 if none)
+ */
+static unsigned long pmu_snapshot_off;
+
 /* Maximum number of hardware events available */
 static uint32_t num_hw_events;
 /* Maximum number of hardware counters available */
@@ -81,6 +98,27 @@ static uint32_t total_ctrs;
 #define get_cidx_type(x) ((x & SBI_PMU_EVENT_IDX_TYPE_MASK) >> 16)
 #define get_cidx_code(x) (x & SBI_PMU_EVENT_IDX_CODE_MASK)
 
+/*
+ * Implementation specific firmware events are mapped right after the
+ * standard firmware events in the per-HART firmware event map.
+ */
+#define PMU_FW_IMPL_COUNT	(SBI_PMU_FW_IMPL_END - SBI_PMU_FW_IMPL_START)
+
+_Static_assert(
+	SBI_PMU_FW_MAX + PMU_FW_IMPL_COUNT <= SBI_PMU_FW_EVENT_MAX,
+	"firmware events don't fit in the firmware event map");
+
+static inline int pmu_fw_event_slot(uint32_t fw_evt_code)
+{
+	if (fw_evt_code < SBI_PMU_FW_MAX)
+		return fw_evt_code;
+	if (SBI_PMU_FW_IMPL_START <= fw_evt_code &&
+	    fw_evt_code < SBI_PMU_FW_IMPL_END)
+		return SBI_PMU_FW_MAX + (fw_evt_code - SBI_PMU_FW_IMPL_START);
+
+	return SBI_EINVAL;
+}
+
 /**
  * Perform a sanity check on event & counter mappings with event range overlap check
  * @param evtA Pointer to the existing hw event structure
@@ -119,8 +157,9 @@ static int pmu_event_validate(unsigned long event_idx)
 		event_idx_code_max = SBI_PMU_HW_GENERAL_MAX;
 		break;
 	case SBI_PMU_EVENT_TYPE_FW:
-		event_idx_code_max = SBI_PMU_FW_MAX;
-		break;
+		if (pmu_fw_event_slot(event_idx_code) < 0)
+			return SBI_EINVAL;
+		return event_idx_type;
 	case SBI_PMU_EVENT_TYPE_HW_CACHE:
 		cache_ops_result = event_idx_code &
 					SBI_PMU_EVENT_HW_CACHE_OPS_RESULT;
@@ -176,7 +215,7 @@ static int pmu_ctr_read_fw(uint32_t cidx, unsigned long *cval,
 	u32 hartid = current_hartid();
 	struct sbi_pmu_fw_event fevent;
 
-	fevent = fw_event_map[hartid][fw_evt_code];
+	fevent = fw_event_map[hartid][pmu_fw_event_slot(fw_evt_code)];
 	*cval = fevent.curr_count;
 
 	return 0;
@@ -373,7 +412,7 @@ static int pmu_ctr_start_fw(uint32_t cidx, uint32_t fw_evt_code,
 	u32 hartid = current_hartid();
 	struct sbi_pmu_fw_event *fevent;
 
-	fevent = &fw_event_map[hartid][fw_evt_code];
+	fevent = &fw_event_map[hartid][pmu_fw_event_slot(fw_evt_code)];
 	if (ival_update)
 		fevent->curr_count = ival;
 	fevent->bStarted = TRUE;
@@ -381,9 +420,17 @@ static int pmu_ctr_start_fw(uint32_t cidx, uint32_t fw_evt_code,
 	return 0;
 }
 
+static inline struct sbi_pmu_snapshot *pmu_snapshot_ptr(void)
+{
+	unsigned long *addr = sbi_scratch_thishart_offset_ptr(pmu_snapshot_off);
+
+	return (struct sbi_pmu_snapshot *)*addr;
+}
+
 int sbi_pmu_ctr_start(unsigned long cbase, unsigned long cmask,
 		      unsigned long flags, uint64_t ival)
 {
+	struct sbi_pmu_snapshot *snap = NULL;
 	int event_idx_type;
 	uint32_t event_code;
 	int ret = SBI_EINVAL;
@@ -396,13 +443,25 @@ int sbi_pmu_ctr_start(unsigned long cbase, unsigned long cmask,
 	if (flags & SBI_PMU_START_FLAG_SET_INIT_VALUE)
 		bUpdate = TRUE;
 
+	if (flags & SBI_PMU_START_FLAG_INIT_SNAPSHOT) {
+		snap = pmu_snapshot_ptr();
+		if (!snap)
+			return SBI_ENO_SHMEM;
+		bUpdate = TRUE;
+	}
+
 	for_each_set_bit(i, &cmask, total_ctrs) {
 		cidx = i + cbase;
 		event_idx_type = pmu_ctr_validate(cidx, &event_code);
 		if (event_idx_type < 0)
 			/* Continue the start operation for other counters */
 			continue;
-		else if (event_idx_type == SBI_PMU_EVENT_TYPE_FW)
+
+		/* Initial values come from the snapshot for each counter */
+		if (snap)
+			ival = snap->ctr_values[i];
+
+		if (event_idx_type == SBI_PMU_EVENT_TYPE_FW)
 			ret = pmu_ctr_start_fw(cidx, event_code, ival, bUpdate);
 		else
 			ret = pmu_ctr_start_hw(cidx, ival, bUpdate);
@@ -437,11 +496,47 @@ static int pmu_ctr_stop_fw(uint32_t cidx, uint32_t fw_evt_code)
 {
 	u32 hartid = current_hartid();
 
-	fw_event_map[hartid][fw_evt_code].bStarted = FALSE;
+	fw_event_map[hartid][pmu_fw_event_slot(fw_evt_code)].bStarted = FALSE;
 
 	return 0;
 }
 
+static bool pmu_ctr_hw_overflowed(uint32_t cidx)
+{
+	if (cidx < 3 || cidx >= num_hw_ctrs ||
+	    !sbi_hart_has_extension(sbi_scratch_thishart_ptr(),
+				    SBI_HART_EXT_SSCOFPMF))
+		return FALSE;
+
+#if __riscv_xlen == 32
+	return (csr_read_num(CSR_MHPMEVENT3H + cidx - 3) & MHPMEVENTH_OF) ?
+		TRUE : FALSE;
+#else
+	return (csr_read_num(CSR_MHPMEVENT3 + cidx - 3) & MHPMEVENT_OF) ?
+		TRUE : FALSE;
+#endif
+}
+
+/* Save the value of a stopped counter and return its overflow state */
+static bool pmu_ctr_snapshot_save(struct sbi_pmu_snapshot *snap, int i,
+				  uint32_t cidx, int event_idx_type,
+				  uint32_t event_code)
+{
+	unsigned long fw_val;
+	uint64_t val = 0;
+
+	if (event_idx_type == SBI_PMU_EVENT_TYPE_FW) {
+		pmu_ctr_read_fw(cidx, &fw_val, event_code);
+		snap->ctr_values[i] = fw_val;
+		return FALSE;
+	}
+
+	pmu_ctr_read_hw(cidx, &val);
+	snap->ctr_values[i] = val;
+
+	return pmu_ctr_hw_overflowed(cidx);
+}
+
 static int pmu_reset_hw_mhpmevent(int ctr_idx)
 {
 	if (ctr_idx < 3 || ctr_idx >= SBI_PMU_HW_CTR_MAX)
@@ -462,6 +557,8 @@ int sbi_pmu_ctr_stop(unsigned long cbase, unsigned long cmask,
 		     unsigned long flag)
 {
 	u32 hartid = current_hartid();
+	struct sbi_pmu_snapshot *snap = NULL;
+	uint64_t of_mask = 0;
 	int ret = SBI_EINVAL;
 	int event_idx_type;
 	uint32_t event_code;
@@ -470,6 +567,12 @@ int sbi_pmu_ctr_stop(unsigned long cbase, unsigned long cmask,
 	if ((cbase + sbi_fls(cmask)) >= total_ctrs)
 		return SBI_EINVAL;
 
+	if (flag & SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT) {
+		snap = pmu_snapshot_ptr();
+		if (!snap)
+			return SBI_ENO_SHMEM;
+	}
+
 	for_each_set_bit(i, &cmask, total_ctrs) {
 		cidx = i + cbase;
 		event_idx_type = pmu_ctr_validate(cidx, &event_code);
@@ -482,15 +585,52 @@ int sbi_pmu_ctr_stop(unsigned long cbase, unsigned long cmask,
 		else
 			ret = pmu_ctr_stop_hw(cidx);
 
+		/* Overflow state lives in mhpmevent so save it before reset */
+		if (snap && pmu_ctr_snapshot_save(snap, i, cidx,
+						  event_idx_type, event_code))
+			of_mask |= BIT(i);
+
 		if (flag & SBI_PMU_STOP_FLAG_RESET) {
 			active_events[hartid][cidx] = SBI_PMU_EVENT_IDX_INVALID;
 			pmu_reset_hw_mhpmevent(cidx);
 		}
 	}
 
+	if (snap)
+		snap->ctr_overflow_mask =
+			(snap->ctr_overflow_mask & ~(uint64_t)cmask) | of_mask;
+
 	return ret;
 }
 
+int sbi_pmu_snapshot_set_shmem(unsigned long lo, unsigned long hi,
+			       unsigned long flags)
+{
+	const struct sbi_domain *dom = sbi_domain_thishart_ptr();
+	unsigned long *addr = sbi_scratch_thishart_offset_ptr(pmu_snapshot_off);
+
+	/* No flags are defined yet */
+	if (flags)
+		return SBI_EINVAL;
+
+	if (lo == SBI_PMU_SNAPSHOT_SHMEM_DISABLE &&
+	    hi == SBI_PMU_SNAPSHOT_SHMEM_DISABLE) {
+		*addr = 0;
+		return 0;
+	}
+
+	/* Only addresses reachable by M-mode are accepted */
+	if (hi || !lo || (lo & (SBI_PMU_SNAPSHOT_SHMEM_SIZE - 1)))
+		return SBI_EINVALID_ADDR;
+	if (!sbi_domain_check_addr_range(dom, lo, SBI_PMU_SNAPSHOT_SHMEM_SIZE,
+					 PRV_S,
+					 SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return SBI_EINVALID_ADDR;
+
+	*addr = lo;
+	return 0;
+}
+
 static void pmu_update_inhibit_flags(unsigned long flags, uint64_t *mhpmevent_val)
 {
 	if (flags & SBI_PMU_CFG_FLAG_SET_VUINH)
@@ -700,7 +840,7 @@ skip_match:
 			pmu_ctr_start_hw(ctr_idx, 0, false);
 	} else if (event_type == SBI_PMU_EVENT_TYPE_FW) {
 		fw_evt_code = get_cidx_code(event_idx);
-		fevent = &fw_event_map[hartid][fw_evt_code];
+		fevent = &fw_event_map[hartid][pmu_fw_event_slot(fw_evt_code)];
 		if (flags & SBI_PMU_CFG_FLAG_CLEAR_VALUE)
 			fevent->curr_count = 0;
 		if (flags & SBI_PMU_CFG_FLAG_AUTO_START)
@@ -714,11 +854,12 @@ inline int sbi_pmu_ctr_incr_fw(enum sbi_pmu_fw_event_code_id fw_id)
 {
 	u32 hartid = current_hartid();
 	struct sbi_pmu_fw_event *fevent;
+	int slot = pmu_fw_event_slot(fw_id);
 
-	if (unlikely(fw_id >= SBI_PMU_FW_MAX))
+	if (unlikely(slot < 0))
 		return SBI_EINVAL;
 
-	fevent = &fw_event_map[hartid][fw_id];
+	fevent = &fw_event_map[hartid][slot];
 
 	/* PMU counters will be only enabled during performance debugging */
 	if (unlikely(fevent->bStarted))
@@ -727,6 +868,23 @@ inline int sbi_pmu_ctr_incr_fw(enum sbi_pmu_fw_event_code_id fw_id)
 	return 0;
 }
 
+int sbi_pmu_ctr_add_fw(enum sbi_pmu_fw_event_code_id fw_id, unsigned long val)
+{
+	u32 hartid = current_hartid();
+	struct sbi_pmu_fw_event *fevent;
+	int slot = pmu_fw_event_slot(fw_id);
+
+	if (unlikely(slot < 0))
+		return SBI_EINVAL;
+
+	fevent = &fw_event_map[hartid][slot];
+
+	if (unlikely(fevent->bStarted))
+		fevent->curr_count += val;
+
+	return 0;
+}
+
 unsigned long sbi_pmu_num_ctr(void)
 {
 	return (num_hw_ctrs + SBI_PMU_FW_CTR_MAX);
@@ -772,6 +930,8 @@ static void pmu_reset_event_map(u32 hartid)
 	for (j = 0; j < SBI_PMU_FW_EVENT_MAX; j++)
 		sbi_memset(&fw_event_map[hartid][j], 0,
 			   sizeof(struct sbi_pmu_fw_event));
+	*((unsigned long *)sbi_scratch_offset_ptr(
+			sbi_hartid_to_scratch(hartid), pmu_snapshot_off)) = 0;
 }
 
 void sbi_pmu_exit(struct sbi_scratch *scratch)
@@ -799,6 +959,13 @@ int sbi_pmu_init(struct sbi_scratch *scratch, bool cold_boot)
 		/* mcycle & minstret is available always */
 		num_hw_ctrs = sbi_hart_mhpm_count(scratch) + 3;
 		total_ctrs = num_hw_ctrs + SBI_PMU_FW_CTR_MAX;
+
+		pmu_snapshot_off = sbi_scratch_alloc_offset(
+						sizeof(unsigned long));
+		if (!pmu_snapshot_off)
+			return SBI_ENOMEM;
+	} else if (!pmu_snapshot_off) {
+		return SBI_ENOMEM;
 	}
 
 	pmu_reset_event_map(hartid);
@@ -20,6 +20,7 @@
 #include <sbi/sbi_hfence.h>
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_console.h>
+#include <sbi/sbi_domain.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_pmu.h>
 
@@ -27,16 +28,103 @@ static unsigned long tlb_sync_off;
 static unsigned long tlb_fifo_off;
 static unsigned long tlb_fifo_mem_off;
 static unsigned long tlb_range_flush_limit;
+static unsigned long tlb_flush_limit_off;
+static unsigned long tlb_sticky_off;
+static unsigned long tlb_bcast_off;
+static unsigned long tlb_bcast_src_off;
+
+/** Broadcast descriptor published by a HART for multiple targets */
+struct tlb_bcast {
+	/** TLB request shared by all targets */
+	struct sbi_tlb_info tinfo;
+	/** Number of references (targets and sender) yet to be dropped */
+	atomic_t pending;
+	/** Sequence number of the published request */
+	unsigned long seq;
+	/** Sequence number of the last completed request */
+	unsigned long done_seq;
+	/** Address of completion word in supervisor memory (0 if unused) */
+	unsigned long done_addr;
+	/** Sequence number last stored in the completion word */
+	unsigned long reported_seq;
+	/** HART owning the descriptor (only it stores the completion word) */
+	u32 hartid;
+	/** Published request is asynchronous (owner is not waiting) */
+	bool async;
+};
+
+/*
+ * Sticky flush requests used for FENCE.I, for flush-all requests and
+ * when the TLB fifo of a HART is full. These are idempotent so any
+ * number of requests is folded into a single bit.
+ *
+ * The VMID of a pending HFENCE.VVMA flush-all is stored in the upper
+ * bits of the same word so that it can be claimed atomically.
+ */
+#define TLB_STICKY_FENCE_I		(1UL << 0)
+#define TLB_STICKY_SFENCE_VMA		(1UL << 1)
+#define TLB_STICKY_HFENCE_GVMA		(1UL << 2)
+#define TLB_STICKY_HFENCE_VVMA		(1UL << 3)
+#define TLB_STICKY_VMID_SHIFT		8
+
+/** Sticky flush requests pending on a HART */
+struct tlb_sticky {
+	/** Pending sticky flush requests */
+	atomic_t pending;
+	/** HARTs waiting for the sticky requests to complete */
+	struct sbi_hartmask waiters;
+};
 
 static void tlb_flush_all(void)
 {
 	__asm__ __volatile("sfence.vma");
 }
 
-void sbi_tlb_local_hfence_vvma(struct sbi_tlb_info *tinfo)
+static inline bool tlb_has_svinval(void)
+{
+	return sbi_hart_has_extension(sbi_scratch_thishart_ptr(),
+				      SBI_HART_EXT_SVINVAL);
+}
+
+static void tlb_flush_range(unsigned long start, unsigned long size,
+			    unsigned long stride)
+{
+	unsigned long i;
+
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += stride)
+			__sbi_sinval_vma_va(start + i);
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
+	for (i = 0; i < size; i += stride) {
+		__asm__ __volatile__("sfence.vma %0"
+				     :
+				     : "r"(start + i)
+				     : "memory");
+	}
+}
+
+static inline unsigned long tlb_flush_limit(struct sbi_scratch *scratch,
+					    struct sbi_tlb_info *tinfo)
+{
+	unsigned long *limit = sbi_scratch_offset_ptr(scratch,
+						      tlb_flush_limit_off);
+
+	/* Limit is in 4KB pages worth of flushes so scale it by stride */
+	if (*limit > (SBI_TLB_FLUSH_ALL >> tinfo->order))
+		return SBI_TLB_FLUSH_ALL;
+
+	return *limit << tinfo->order;
+}
+
+static void tlb_local_hfence_vvma(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
 	unsigned long size  = tinfo->size;
+	unsigned long stride = PAGE_SIZE << tinfo->order;
 	unsigned long vmid  = tinfo->vmid;
 	unsigned long i, hgatp;
 
@@ -50,7 +138,15 @@ void sbi_tlb_local_hfence_vvma(struct sbi_tlb_info *tinfo)
 		goto done;
 	}
 
-	for (i = 0; i < size; i += PAGE_SIZE) {
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += stride)
+			__sbi_hinval_vvma_va(start + i);
+		__sbi_sfence_inval_ir();
+		goto done;
+	}
+
+	for (i = 0; i < size; i += stride) {
 		__sbi_hfence_vvma_va(start+i);
 	}
 
@@ -58,10 +154,11 @@ done:
 	csr_write(CSR_HGATP, hgatp);
 }
 
-void sbi_tlb_local_hfence_gvma(struct sbi_tlb_info *tinfo)
+static void tlb_local_hfence_gvma(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
 	unsigned long size  = tinfo->size;
+	unsigned long stride = PAGE_SIZE << tinfo->order;
 	unsigned long i;
 
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_GVMA_RCVD);
@@ -71,16 +168,24 @@ void sbi_tlb_local_hfence_gvma(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
-	for (i = 0; i < size; i += PAGE_SIZE) {
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += stride)
+			__sbi_hinval_gvma_gpa((start + i) >> 2);
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
+	for (i = 0; i < size; i += stride) {
 		__sbi_hfence_gvma_gpa((start + i) >> 2);
 	}
 }
 
-void sbi_tlb_local_sfence_vma(struct sbi_tlb_info *tinfo)
+static void tlb_local_sfence_vma(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
 	unsigned long size  = tinfo->size;
-	unsigned long i;
+	unsigned long stride = PAGE_SIZE << tinfo->order;
 
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SFENCE_VMA_RCVD);
 
@@ -89,18 +194,14 @@ void sbi_tlb_local_sfence_vma(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
-	for (i = 0; i < size; i += PAGE_SIZE) {
-		__asm__ __volatile__("sfence.vma %0"
-				     :
-				     : "r"(start + i)
-				     : "memory");
-	}
+	tlb_flush_range(start, size, stride);
 }
 
-void sbi_tlb_local_hfence_vvma_asid(struct sbi_tlb_info *tinfo)
+static void tlb_local_hfence_vvma_asid(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
 	unsigned long size  = tinfo->size;
+	unsigned long stride = PAGE_SIZE << tinfo->order;
 	unsigned long asid  = tinfo->asid;
 	unsigned long vmid  = tinfo->vmid;
 	unsigned long i, hgatp;
@@ -120,7 +221,15 @@ void sbi_tlb_local_hfence_vvma_asid(struct sbi_tlb_info *tinfo)
 		goto done;
 	}
 
-	for (i = 0; i < size; i += PAGE_SIZE) {
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += stride)
+			__sbi_hinval_vvma_asid_va(start + i, asid);
+		__sbi_sfence_inval_ir();
+		goto done;
+	}
+
+	for (i = 0; i < size; i += stride) {
 		__sbi_hfence_vvma_asid_va(start + i, asid);
 	}
 
@@ -128,10 +237,11 @@ done:
 	csr_write(CSR_HGATP, hgatp);
 }
 
-void sbi_tlb_local_hfence_gvma_vmid(struct sbi_tlb_info *tinfo)
+static void tlb_local_hfence_gvma_vmid(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
 	unsigned long size  = tinfo->size;
+	unsigned long stride = PAGE_SIZE << tinfo->order;
 	unsigned long vmid  = tinfo->vmid;
 	unsigned long i;
 
@@ -147,15 +257,24 @@ void sbi_tlb_local_hfence_gvma_vmid(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
-	for (i = 0; i < size; i += PAGE_SIZE) {
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += stride)
+			__sbi_hinval_gvma_vmid_gpa((start + i) >> 2, vmid);
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
+	for (i = 0; i < size; i += stride) {
 		__sbi_hfence_gvma_vmid_gpa((start + i) >> 2, vmid);
 	}
 }
 
-void sbi_tlb_local_sfence_vma_asid(struct sbi_tlb_info *tinfo)
+static void tlb_local_sfence_vma_asid(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
 	unsigned long size  = tinfo->size;
+	unsigned long stride = PAGE_SIZE << tinfo->order;
 	unsigned long asid  = tinfo->asid;
 	unsigned long i;
 
@@ -175,7 +294,15 @@ void sbi_tlb_local_sfence_vma_asid(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
-	for (i = 0; i < size; i += PAGE_SIZE) {
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += stride)
+			__sbi_sinval_vma_asid_va(start + i, asid);
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
+	for (i = 0; i < size; i += stride) {
 		__asm__ __volatile__("sfence.vma %0, %1"
 				     :
 				     : "r"(start + i), "r"(asid)
@@ -183,49 +310,179 @@ void sbi_tlb_local_sfence_vma_asid(struct sbi_tlb_info *tinfo)
 	}
 }
 
-void sbi_tlb_local_fence_i(struct sbi_tlb_info *tinfo)
+static void tlb_local_fence_i(struct sbi_tlb_info *tinfo)
 {
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_FENCE_I_RECVD);
 
 	__asm__ __volatile("fence.i");
 }
 
+static void (*const tlb_local_fn[])(struct sbi_tlb_info *tinfo) = {
+	[SBI_TLB_FENCE_I] = tlb_local_fence_i,
+	[SBI_TLB_SFENCE_VMA] = tlb_local_sfence_vma,
+	[SBI_TLB_SFENCE_VMA_ASID] = tlb_local_sfence_vma_asid,
+	[SBI_TLB_HFENCE_GVMA_VMID] = tlb_local_hfence_gvma_vmid,
+	[SBI_TLB_HFENCE_GVMA] = tlb_local_hfence_gvma,
+	[SBI_TLB_HFENCE_VVMA_ASID] = tlb_local_hfence_vvma_asid,
+	[SBI_TLB_HFENCE_VVMA] = tlb_local_hfence_vvma,
+};
+
+static const enum sbi_pmu_fw_event_code_id tlb_fw_sent_event[] = {
+	[SBI_TLB_FENCE_I] = SBI_PMU_FW_FENCE_I_SENT,
+	[SBI_TLB_SFENCE_VMA] = SBI_PMU_FW_SFENCE_VMA_SENT,
+	[SBI_TLB_SFENCE_VMA_ASID] = SBI_PMU_FW_SFENCE_VMA_ASID_SENT,
+	[SBI_TLB_HFENCE_GVMA_VMID] = SBI_PMU_FW_HFENCE_GVMA_VMID_SENT,
+	[SBI_TLB_HFENCE_GVMA] = SBI_PMU_FW_HFENCE_GVMA_SENT,
+	[SBI_TLB_HFENCE_VVMA_ASID] = SBI_PMU_FW_HFENCE_VVMA_ASID_SENT,
+	[SBI_TLB_HFENCE_VVMA] = SBI_PMU_FW_HFENCE_VVMA_SENT,
+};
+
+static inline void tlb_local_flush(struct sbi_tlb_info *tinfo)
+{
+	tlb_local_fn[tinfo->type](tinfo);
+}
+
 static void tlb_pmu_incr_fw_ctr(struct sbi_tlb_info *data)
 {
 	if (unlikely(!data))
 		return;
 
-	if (data->local_fn == sbi_tlb_local_fence_i)
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_FENCE_I_SENT);
-	else if (data->local_fn == sbi_tlb_local_sfence_vma)
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SFENCE_VMA_SENT);
-	else if (data->local_fn == sbi_tlb_local_sfence_vma_asid)
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SFENCE_VMA_ASID_SENT);
-	else if (data->local_fn == sbi_tlb_local_hfence_gvma)
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_GVMA_SENT);
-	else if (data->local_fn == sbi_tlb_local_hfence_gvma_vmid)
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_GVMA_VMID_SENT);
-	else if (data->local_fn == sbi_tlb_local_hfence_vvma)
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_VVMA_SENT);
-	else if (data->local_fn == sbi_tlb_local_hfence_vvma_asid)
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_VVMA_ASID_SENT);
+	sbi_pmu_ctr_incr_fw(tlb_fw_sent_event[data->type]);
 }
 
-static void tlb_entry_process(struct sbi_tlb_info *tinfo)
+static void tlb_ack(struct sbi_hartmask *smask)
 {
 	u32 rhartid;
 	struct sbi_scratch *rscratch = NULL;
 	unsigned long *rtlb_sync = NULL;
 
-	tinfo->local_fn(tinfo);
-
-	sbi_hartmask_for_each_hart(rhartid, &tinfo->smask) {
+	sbi_hartmask_for_each_hart(rhartid, smask) {
 		rscratch = sbi_hartid_to_scratch(rhartid);
 		if (!rscratch)
 			continue;
 
 		rtlb_sync = sbi_scratch_offset_ptr(rscratch, tlb_sync_off);
-		while (atomic_raw_xchg_ulong(rtlb_sync, 1)) ;
+		while (atomic_raw_xchg_ulong(rtlb_sync, 1))
+			sbi_ipi_forward_pending();
+	}
+}
+
+static void tlb_sticky_process(struct sbi_scratch *scratch)
+{
+	u32 i;
+	unsigned long pending, vmid, hgatp, waiting = 0;
+	struct sbi_hartmask waiters;
+	struct tlb_sticky *tlb_sticky =
+			sbi_scratch_offset_ptr(scratch, tlb_sticky_off);
+
+	/*
+	 * Senders set the pending bits before the waiter bit so claim
+	 * the waiters first. A waiter missed over here is acked the
+	 * next time after one more (harmless) flush.
+	 */
+	for (i = 0; i < BITS_TO_LONGS(SBI_HARTMASK_MAX_BITS); i++) {
+		waiters.bits[i] = atomic_raw_xchg_ulong(
+					&tlb_sticky->waiters.bits[i], 0);
+		waiting |= waiters.bits[i];
+	}
+
+	pending = atomic_xchg(&tlb_sticky->pending, 0);
+	if (!pending && !waiting)
+		return;
+
+	if (pending & TLB_STICKY_FENCE_I) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_FENCE_I_RECVD);
+		__asm__ __volatile("fence.i");
+	}
+	if (pending & TLB_STICKY_SFENCE_VMA) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SFENCE_VMA_RCVD);
+		tlb_flush_all();
+	}
+	if (pending & TLB_STICKY_HFENCE_GVMA) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_GVMA_RCVD);
+		__sbi_hfence_gvma_all();
+	}
+	if (pending & TLB_STICKY_HFENCE_VVMA) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_VVMA_RCVD);
+		vmid = pending >> TLB_STICKY_VMID_SHIFT;
+		hgatp = csr_swap(CSR_HGATP,
+				 (vmid << HGATP_VMID_SHIFT) & HGATP_VMID_MASK);
+		__sbi_hfence_vvma_all();
+		csr_write(CSR_HGATP, hgatp);
+	}
+
+	if (waiting)
+		tlb_ack(&waiters);
+}
+
+/*
+ * Convert the TLB request into a sticky flush request of the target
+ * HART. Returns false if the request can not be converted.
+ */
+static bool tlb_sticky_update(struct sbi_scratch *remote_scratch,
+				struct sbi_tlb_info *tinfo)
+{
+	long pending, new_pending;
+	unsigned long bit, vmid = 0;
+	struct tlb_sticky *rtlb_sticky =
+			sbi_scratch_offset_ptr(remote_scratch, tlb_sticky_off);
+
+	switch (tinfo->type) {
+	case SBI_TLB_FENCE_I:
+		bit = TLB_STICKY_FENCE_I;
+		break;
+	case SBI_TLB_SFENCE_VMA:
+	case SBI_TLB_SFENCE_VMA_ASID:
+		bit = TLB_STICKY_SFENCE_VMA;
+		break;
+	case SBI_TLB_HFENCE_GVMA:
+	case SBI_TLB_HFENCE_GVMA_VMID:
+		bit = TLB_STICKY_HFENCE_GVMA;
+		break;
+	case SBI_TLB_HFENCE_VVMA:
+	case SBI_TLB_HFENCE_VVMA_ASID:
+		bit = TLB_STICKY_HFENCE_VVMA;
+		vmid = (unsigned long)tinfo->vmid << TLB_STICKY_VMID_SHIFT;
+		break;
+	default:
+		return FALSE;
+	}
+
+	do {
+		pending = atomic_read(&rtlb_sticky->pending);
+		/* Only one VMID can have a sticky HFENCE.VVMA pending */
+		if ((bit & TLB_STICKY_HFENCE_VVMA) &&
+		    (pending & TLB_STICKY_HFENCE_VVMA) &&
+		    ((pending & ~((1UL << TLB_STICKY_VMID_SHIFT) - 1)) != vmid))
+			return FALSE;
+		new_pending = pending | bit | vmid;
+	} while (atomic_cmpxchg(&rtlb_sticky->pending,
+				pending, new_pending) != pending);
+
+	atomic_raw_set_bit(current_hartid(), rtlb_sticky->waiters.bits);
+
+	return TRUE;
+}
+
+static void tlb_entry_process(struct sbi_tlb_info *tinfo)
+{
+	tlb_local_flush(tinfo);
+	tlb_ack(&tinfo->smask);
+}
+
+static bool tlb_is_sticky(struct sbi_tlb_info *tinfo)
+{
+	bool flush_all = (tinfo->size == SBI_TLB_FLUSH_ALL ||
+			  (!tinfo->start && !tinfo->size)) ? TRUE : FALSE;
+
+	switch (tinfo->type) {
+	case SBI_TLB_FENCE_I:
+		return TRUE;
+	case SBI_TLB_SFENCE_VMA:
+	case SBI_TLB_HFENCE_GVMA:
+		return flush_all;
+	default:
+		return FALSE;
 	}
 }
 
@@ -236,6 +493,8 @@ static void tlb_process_count(struct sbi_scratch *scratch, int count)
 	struct sbi_fifo *tlb_fifo =
 			sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
 
+	tlb_sticky_process(scratch);
+
 	while (!sbi_fifo_dequeue(tlb_fifo, &tinfo)) {
 		tlb_entry_process(&tinfo);
 		deq_count++;
@@ -245,12 +504,105 @@ static void tlb_process_count(struct sbi_scratch *scratch, int count)
 	}
 }
 
+static u32 tlb_done_event = SBI_IPI_EVENT_MAX;
+
+/*
+ * Store the last completed sequence number in the completion word. This
+ * is only done by the HART owning the descriptor and the address is
+ * checked against its current domain at the time of the store.
+ */
+static void tlb_bcast_report(struct tlb_bcast *tlb_bcast)
+{
+	unsigned long seq, addr = tlb_bcast->done_addr;
+
+	if (!addr)
+		return;
+
+	seq = __smp_load_acquire(&tlb_bcast->done_seq);
+	if (seq == tlb_bcast->reported_seq)
+		return;
+
+	if (!sbi_domain_check_addr(sbi_domain_thishart_ptr(), addr, PRV_S,
+				   SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return;
+
+	*((volatile unsigned long *)addr) = seq;
+	tlb_bcast->reported_seq = seq;
+}
+
+static void tlb_bcast_put(struct tlb_bcast *tlb_bcast)
+{
+	u32 hartid;
+	bool async;
+	unsigned long seq, done_addr;
+
+	/* The owner can reuse the descriptor once our reference is gone */
+	seq = tlb_bcast->seq;
+	done_addr = tlb_bcast->done_addr;
+	hartid = tlb_bcast->hartid;
+	async = tlb_bcast->async;
+
+	if (atomic_sub_return(&tlb_bcast->pending, 1))
+		return;
+
+	/* Last reference dropped so report completion */
+	__smp_store_release(&tlb_bcast->done_seq, seq);
+
+	/* A synchronous owner reports after its own wait */
+	if (!async || !done_addr)
+		return;
+
+	/*
+	 * Don't send an IPI from here because this typically runs while
+	 * processing IPIs. Only mark the completion event pending so the
+	 * owner stores the completion word when it takes its next IPI
+	 * or polls the completion status, whichever comes first.
+	 */
+	if (hartid == current_hartid())
+		tlb_bcast_report(tlb_bcast);
+	else
+		sbi_ipi_set_pending(hartid, tlb_done_event);
+}
+
+static void tlb_bcast_process(struct sbi_scratch *scratch)
+{
+	u32 i, rhartid;
+	unsigned long srcs;
+	struct tlb_bcast *rbcast;
+	struct sbi_scratch *rscratch;
+	struct sbi_hartmask *tlb_bcast_src =
+			sbi_scratch_offset_ptr(scratch, tlb_bcast_src_off);
+
+	for (i = 0; i < BITS_TO_LONGS(SBI_HARTMASK_MAX_BITS); i++) {
+		srcs = atomic_raw_xchg_ulong(&tlb_bcast_src->bits[i], 0);
+		while (srcs) {
+			rhartid = i * BITS_PER_LONG + sbi_ffs(srcs);
+			srcs &= srcs - 1;
+
+			rscratch = sbi_hartid_to_scratch(rhartid);
+			if (!rscratch)
+				continue;
+
+			/*
+			 * The source HART does not reuse its descriptor
+			 * until all targets have acknowledged it.
+			 */
+			rbcast = sbi_scratch_offset_ptr(rscratch, tlb_bcast_off);
+			tlb_local_flush(&rbcast->tinfo);
+			tlb_bcast_put(rbcast);
+		}
+	}
+}
+
 static void tlb_process(struct sbi_scratch *scratch)
 {
 	struct sbi_tlb_info tinfo;
 	struct sbi_fifo *tlb_fifo =
 			sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
 
+	/* Sticky flush requests are applied before draining the fifo */
+	tlb_sticky_process(scratch);
+
 	while (!sbi_fifo_dequeue(tlb_fifo, &tinfo))
 		tlb_entry_process(&tinfo);
 }
@@ -263,53 +615,159 @@ static void tlb_sync(struct sbi_scratch *scratch)
 	while (!atomic_raw_xchg_ulong(tlb_sync, 0)) {
 		/*
 		 * While we are waiting for remote hart to set the sync,
-		 * consume fifo requests to avoid deadlock.
+		 * consume fifo requests and forward queued IPIs to
+		 * avoid deadlock.
 		 */
+		sbi_ipi_forward_pending();
 		tlb_process_count(scratch, 1);
+		tlb_bcast_process(scratch);
 	}
 
 	return;
 }
 
+static void tlb_bcast_sync(struct sbi_scratch *scratch)
+{
+	struct tlb_bcast *tlb_bcast =
+			sbi_scratch_offset_ptr(scratch, tlb_bcast_off);
+
+	while (atomic_read(&tlb_bcast->pending)) {
+		/*
+		 * While we are waiting for remote harts to acknowledge,
+		 * consume their requests and forward queued IPIs to
+		 * avoid deadlock.
+		 */
+		sbi_ipi_forward_pending();
+		tlb_process_count(scratch, 1);
+		tlb_bcast_process(scratch);
+	}
+}
+
+static inline unsigned long tlb_range_end(struct sbi_tlb_info *tinfo)
+{
+	if (tinfo->size > (SBI_TLB_FLUSH_ALL - tinfo->start))
+		return SBI_TLB_FLUSH_ALL;
+	return tinfo->start + tinfo->size;
+}
+
+static inline void tlb_range_flush_all(struct sbi_tlb_info *tinfo)
+{
+	tinfo->start = 0;
+	tinfo->size = SBI_TLB_FLUSH_ALL;
+}
+
+static inline bool tlb_range_everything(struct sbi_tlb_info *tinfo)
+{
+	return (!tinfo->start && !tinfo->size) ? TRUE : FALSE;
+}
+
 static inline int tlb_range_check(struct sbi_tlb_info *curr,
-					struct sbi_tlb_info *next)
+				  struct sbi_tlb_info *next,
+				  unsigned long flush_limit)
 {
+	unsigned long start, end;
 	unsigned long curr_end;
 	unsigned long next_end;
-	int ret = SBI_FIFO_UNCHANGED;
 
 	if (!curr || !next)
-		return ret;
+		return SBI_FIFO_UNCHANGED;
 
-	next_end = next->start + next->size;
-	curr_end = curr->start + curr->size;
-	if (next->start <= curr->start && next_end > curr_end) {
-		curr->start = next->start;
-		curr->size  = next->size;
-		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
-		ret = SBI_FIFO_UPDATED;
-	} else if (next->start >= curr->start && next_end <= curr_end) {
-		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
-		ret = SBI_FIFO_SKIP;
+	/*
+	 * Zero start and size means flush everything (for the ASID
+	 * and VMID variants this goes beyond the given ASID or VMID)
+	 * so it contains any other range.
+	 */
+	if (tlb_range_everything(curr))
+		goto skip;
+	if (tlb_range_everything(next)) {
+		curr->start = 0;
+		curr->size = 0;
+		goto update;
 	}
 
-	return ret;
+	next_end = tlb_range_end(next);
+	curr_end = tlb_range_end(curr);
+	if (next->start > curr_end || curr->start > next_end) {
+		/* Disjoint ranges are only merged when too big to flush */
+		if ((curr->size + next->size) <= flush_limit)
+			return SBI_FIFO_UNCHANGED;
+		tlb_range_flush_all(curr);
+		goto update;
+	}
+
+	/* Overlapping or adjacent ranges */
+	start = MIN(curr->start, next->start);
+	end = MAX(curr_end, next_end);
+	if (start == curr->start && end == curr_end)
+		goto skip;
+
+	curr->start = start;
+	curr->size = (end == SBI_TLB_FLUSH_ALL) ? SBI_TLB_FLUSH_ALL :
+						 end - start;
+	if (curr->size > flush_limit)
+		tlb_range_flush_all(curr);
+
+update:
+	sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
+	return SBI_FIFO_UPDATED;
+
+skip:
+	sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
+	return SBI_FIFO_SKIP;
 }
 
+static bool tlb_same_context(struct sbi_tlb_info *curr,
+			     struct sbi_tlb_info *next)
+{
+	if (curr->type != next->type ||
+	    curr->order != next->order)
+		return FALSE;
+
+	switch (next->type) {
+	case SBI_TLB_SFENCE_VMA:
+	case SBI_TLB_HFENCE_GVMA:
+		return TRUE;
+	case SBI_TLB_SFENCE_VMA_ASID:
+		return (next->asid == curr->asid) ? TRUE : FALSE;
+	case SBI_TLB_HFENCE_GVMA_VMID:
+	case SBI_TLB_HFENCE_VVMA:
+		return (next->vmid == curr->vmid) ? TRUE : FALSE;
+	case SBI_TLB_HFENCE_VVMA_ASID:
+		return (next->vmid == curr->vmid &&
+			next->asid == curr->asid) ? TRUE : FALSE;
+	default:
+		return FALSE;
+	}
+}
+
+/** Request passed to the inplace fifo update call back */
+struct tlb_update_req {
+	/** New TLB request */
+	struct sbi_tlb_info *tinfo;
+	/** TLB range flush limit of the target HART */
+	unsigned long flush_limit;
+};
+
 /**
  * Call back to decide if an inplace fifo update is required or next entry can
- * can be skipped. Here are the different cases that are being handled.
+ * can be skipped. Only requests of same type for same ASID and/or VMID are
+ * merged. Here are the different cases that are being handled.
  *
  * Case1:
  *	if next flush request range lies within one of the existing entry, skip
  *	the next entry.
  * Case2:
- *	if flush request range in current fifo entry lies within next flush
- *	request, update the current entry.
+ *	if next flush request range overlaps or is adjacent to the range in
+ *	current fifo entry, extend the current entry to cover both ranges.
+ * Case3:
+ *	if the merged range (or the sum of two disjoint ranges) is larger
+ *	than the TLB range flush limit, update the current entry to flush
+ *	all for the ASID and/or VMID.
  *
  * Note:
- *	We can not issue a fifo reset anymore if a complete vma flush is requested.
- *	This is because we are queueing FENCE.I requests as well now.
+ *	FENCE.I and complete SFENCE.VMA/HFENCE.GVMA flushes are never queued
+ *	in the fifo. These are set as sticky flush requests of the target HART
+ *	which are applied before draining the fifo.
  *	To ease up the pressure in enqueue/fifo sync path, try to dequeue 1 element
  *	before continuing the while loop. This method is preferred over wfi/ipi because
  *	of MMIO cost involved in later method.
@@ -317,23 +775,17 @@ static inline int tlb_range_check(struct sbi_tlb_info *curr,
 static int tlb_update_cb(void *in, void *data)
 {
 	struct sbi_tlb_info *curr;
-	struct sbi_tlb_info *next;
+	struct tlb_update_req *req;
 	int ret = SBI_FIFO_UNCHANGED;
 
 	if (!in || !data)
 		return ret;
 
 	curr = (struct sbi_tlb_info *)data;
-	next = (struct sbi_tlb_info *)in;
+	req = (struct tlb_update_req *)in;
 
-	if (next->local_fn == sbi_tlb_local_sfence_vma_asid &&
-	    curr->local_fn == sbi_tlb_local_sfence_vma_asid) {
-		if (next->asid == curr->asid)
-			ret = tlb_range_check(curr, next);
-	} else if (next->local_fn == sbi_tlb_local_sfence_vma &&
-		   curr->local_fn == sbi_tlb_local_sfence_vma) {
-		ret = tlb_range_check(curr, next);
-	}
+	if (tlb_same_context(curr, req->tinfo))
+		ret = tlb_range_check(curr, req->tinfo, req->flush_limit);
 
 	return ret;
 }
@@ -344,15 +796,18 @@ static int tlb_update(struct sbi_scratch *scratch,
 {
 	int ret;
 	struct sbi_fifo *tlb_fifo_r;
+	struct tlb_update_req req;
 	struct sbi_tlb_info *tinfo = data;
 	u32 curr_hartid = current_hartid();
 
 	/*
-	 * If address range to flush is too big then simply
-	 * upgrade it to flush all because we can only flush
-	 * 4KB at a time.
+	 * If address range to flush is too big for the target
+	 * HART then simply upgrade it to flush all because we
+	 * can only flush 4KB at a time.
 	 */
-	if (tinfo->size > tlb_range_flush_limit) {
+	req.tinfo = tinfo;
+	req.flush_limit = tlb_flush_limit(remote_scratch, tinfo);
+	if (tinfo->size > req.flush_limit) {
 		tinfo->start = 0;
 		tinfo->size = SBI_TLB_FLUSH_ALL;
 	}
@@ -362,27 +817,39 @@ static int tlb_update(struct sbi_scratch *scratch,
 	 * then just do a local flush and return;
 	 */
 	if (remote_hartid == curr_hartid) {
-		tinfo->local_fn(tinfo);
+		tlb_local_flush(tinfo);
 		return -1;
 	}
 
+	/*
+	 * FENCE.I and complete flushes are idempotent so these only
+	 * set a sticky bit of the target HART instead of a fifo entry.
+	 */
+	if (tlb_is_sticky(tinfo) && tlb_sticky_update(remote_scratch, tinfo))
+		return 0;
+
 	tlb_fifo_r = sbi_scratch_offset_ptr(remote_scratch, tlb_fifo_off);
 
-	ret = sbi_fifo_inplace_update(tlb_fifo_r, data, tlb_update_cb);
+	ret = sbi_fifo_inplace_update(tlb_fifo_r, &req, tlb_update_cb);
 	if (ret != SBI_FIFO_UNCHANGED) {
 		return 1;
 	}
 
 	while (sbi_fifo_enqueue(tlb_fifo_r, data) < 0) {
-		/**
-		 * For now, Busy loop until there is space in the fifo.
-		 * There may be case where target hart is also
-		 * enqueue in source hart's fifo. Both hart may busy
-		 * loop leading to a deadlock.
-		 * TODO: Introduce a wait/wakeup event mechanism to handle
-		 * this properly.
+		/*
+		 * The fifo is full so turn the request into a sticky
+		 * flush-all request which the target HART applies
+		 * before draining its fifo. This never stalls unless
+		 * a sticky HFENCE.VVMA is pending for another VMID in
+		 * which case we consume our own requests while waiting
+		 * for space in the fifo.
 		 */
+		if (tlb_sticky_update(remote_scratch, tinfo))
+			break;
+
+		sbi_ipi_forward_pending();
 		tlb_process_count(scratch, 1);
+		tlb_bcast_process(scratch);
 		sbi_dprintf("hart%d: hart%d tlb fifo full\n",
 			    curr_hartid, remote_hartid);
 	}
@@ -390,6 +857,32 @@ static int tlb_update(struct sbi_scratch *scratch,
 	return 0;
 }
 
+static int tlb_bcast_update(struct sbi_scratch *scratch,
+			    struct sbi_scratch *remote_scratch,
+			    u32 remote_hartid, void *data)
+{
+	struct tlb_bcast *tlb_bcast = data;
+	struct sbi_hartmask *rtlb_bcast_src;
+	u32 curr_hartid = current_hartid();
+
+	/*
+	 * If the request is for itself then just do
+	 * a local flush and return;
+	 */
+	if (remote_hartid == curr_hartid) {
+		tlb_local_flush(&tlb_bcast->tinfo);
+		return -1;
+	}
+
+	atomic_add_return(&tlb_bcast->pending, 1);
+
+	rtlb_bcast_src = sbi_scratch_offset_ptr(remote_scratch,
+						tlb_bcast_src_off);
+	atomic_raw_set_bit(curr_hartid, rtlb_bcast_src->bits);
+
+	return 0;
+}
+
 static struct sbi_ipi_event_ops tlb_ops = {
 	.name = "IPI_TLB",
 	.update = tlb_update,
@@ -399,66 +892,358 @@ static struct sbi_ipi_event_ops tlb_ops = {
 
 static u32 tlb_event = SBI_IPI_EVENT_MAX;
 
-int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo)
+static struct sbi_ipi_event_ops tlb_bcast_ops = {
+	.name = "IPI_TLB_BCAST",
+	.update = tlb_bcast_update,
+	.process = tlb_bcast_process,
+};
+
+static u32 tlb_bcast_event = SBI_IPI_EVENT_MAX;
+
+static void tlb_done_process(struct sbi_scratch *scratch)
+{
+	tlb_bcast_report(sbi_scratch_offset_ptr(scratch, tlb_bcast_off));
+}
+
+static struct sbi_ipi_event_ops tlb_done_ops = {
+	.name = "IPI_TLB_DONE",
+	.process = tlb_done_process,
+};
+
+static int tlb_request_bcast(ulong hmask, ulong hbase,
+			     struct sbi_tlb_info *tinfo, bool async)
 {
-	if (!tinfo->local_fn)
+	int ret;
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct tlb_bcast *tlb_bcast =
+			sbi_scratch_offset_ptr(scratch, tlb_bcast_off);
+
+	/* Previous request must complete before reusing the descriptor */
+	tlb_bcast_sync(scratch);
+
+	/*
+	 * Publish a single descriptor for all targets. The upgrade
+	 * to flush all is done once over here instead of per target
+	 * based on the TLB range flush limit of this HART.
+	 */
+	tlb_bcast->tinfo = *tinfo;
+	if (tlb_bcast->tinfo.size > tlb_flush_limit(scratch, tinfo)) {
+		tlb_bcast->tinfo.start = 0;
+		tlb_bcast->tinfo.size = SBI_TLB_FLUSH_ALL;
+	}
+	tlb_bcast->seq++;
+	tlb_bcast->async = async;
+
+	/*
+	 * Hold a reference while sending IPIs so that completion is
+	 * not reported before all targets have been signalled.
+	 */
+	atomic_add_return(&tlb_bcast->pending, 1);
+	ret = sbi_ipi_send_many(hmask, hbase, tlb_bcast_event, tlb_bcast);
+	tlb_bcast_put(tlb_bcast);
+
+	/* Wait once for all targets unless asked not to */
+	if (!async) {
+		tlb_bcast_sync(scratch);
+		tlb_bcast_report(tlb_bcast);
+	}
+
+	return ret;
+}
+
+static int tlb_info_prepare(struct sbi_tlb_info *tinfo)
+{
+	unsigned long end, stride;
+
+	if (tinfo->type >= SBI_TLB_TYPE_MAX)
 		return SBI_EINVAL;
 
+	if (!tinfo->order)
+		return 0;
+	if (tinfo->order >= (__riscv_xlen - PAGE_SHIFT))
+		return SBI_EINVAL;
+	if (!tinfo->size || tinfo->size == SBI_TLB_FLUSH_ALL)
+		return 0;
+
+	/* Align the range so that every overlapping superpage is hit */
+	stride = PAGE_SIZE << tinfo->order;
+	end = tinfo->start + tinfo->size;
+	if (end < tinfo->start) {
+		tinfo->start = 0;
+		tinfo->size = SBI_TLB_FLUSH_ALL;
+		return 0;
+	}
+	tinfo->start &= ~(stride - 1);
+	tinfo->size = end - tinfo->start;
+
+	return 0;
+}
+
+int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo)
+{
+	int ret;
+
+	ret = tlb_info_prepare(tinfo);
+	if (ret)
+		return ret;
+
 	tlb_pmu_incr_fw_ctr(tinfo);
 
+	/*
+	 * FENCE.I only sets a sticky bit of each target HART so it needs
+	 * no shared descriptor. The targets still ack the sticky bit and
+	 * we wait for all of them before returning.
+	 */
+	if (tinfo->type == SBI_TLB_FENCE_I)
+		return sbi_ipi_send_many(hmask, hbase, tlb_event, tinfo);
+
+	/* Use broadcast descriptor when more than one HART is targeted */
+	if (hbase == -1UL || (hmask & (hmask - 1)))
+		return tlb_request_bcast(hmask, hbase, tinfo, FALSE);
+
 	return sbi_ipi_send_many(hmask, hbase, tlb_event, tinfo);
 }
 
+int sbi_tlb_request_async(ulong hmask, ulong hbase,
+			  struct sbi_tlb_info *tinfo, unsigned long *seq)
+{
+	int ret;
+	struct tlb_bcast *tlb_bcast =
+			sbi_scratch_thishart_offset_ptr(tlb_bcast_off);
+
+	ret = tlb_info_prepare(tinfo);
+	if (ret)
+		return ret;
+
+	tlb_pmu_incr_fw_ctr(tinfo);
+
+	ret = tlb_request_bcast(hmask, hbase, tinfo, TRUE);
+	if (seq)
+		*seq = tlb_bcast->seq;
+
+	return ret;
+}
+
+unsigned long sbi_tlb_async_status(void)
+{
+	struct tlb_bcast *tlb_bcast =
+			sbi_scratch_thishart_offset_ptr(tlb_bcast_off);
+
+	/* Catch up if the completion IPI was not delivered yet */
+	tlb_bcast_report(tlb_bcast);
+
+	return __smp_load_acquire(&tlb_bcast->done_seq);
+}
+
+unsigned long sbi_tlb_async_wait(void)
+{
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+
+	tlb_bcast_sync(scratch);
+
+	return sbi_tlb_async_status();
+}
+
+int sbi_tlb_async_set_shmem(unsigned long addr)
+{
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct tlb_bcast *tlb_bcast =
+			sbi_scratch_offset_ptr(scratch, tlb_bcast_off);
+
+	if (addr) {
+		if (addr & (sizeof(unsigned long) - 1))
+			return SBI_EINVALID_ADDR;
+		if (!sbi_domain_check_addr(sbi_domain_thishart_ptr(), addr,
+					   PRV_S, SBI_DOMAIN_READ |
+					   SBI_DOMAIN_WRITE))
+			return SBI_EINVALID_ADDR;
+	}
+
+	/* Don't switch completion word under an outstanding request */
+	tlb_bcast_sync(scratch);
+	tlb_bcast->done_addr = addr;
+	tlb_bcast->reported_seq = 0;
+	tlb_bcast_report(tlb_bcast);
+
+	return 0;
+}
+
+/* Number of pages flushed individually when calibrating */
+#define TLB_CALIBRATE_PAGES		32
+/* Number of calibration rounds (minimum is taken to filter noise) */
+#define TLB_CALIBRATE_ROUNDS		4
+/* Maximum number of pages flushed individually after calibration */
+#define TLB_CALIBRATE_MAX_PAGES		512
+
+/*
+ * Find the range size for which flushing page by page costs about as
+ * much as flushing the entire TLB on the current HART.
+ */
+static unsigned long tlb_calibrate_flush_limit(void)
+{
+	unsigned long i, t, pages;
+	unsigned long full = -1UL, range = -1UL;
+
+	if (!misa_extension('S'))
+		return SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT;
+
+	for (i = 0; i < TLB_CALIBRATE_ROUNDS; i++) {
+		t = csr_read(CSR_MCYCLE);
+		tlb_flush_all();
+		t = csr_read(CSR_MCYCLE) - t;
+		full = MIN(full, t);
+
+		t = csr_read(CSR_MCYCLE);
+		tlb_flush_range(0, TLB_CALIBRATE_PAGES * PAGE_SIZE, PAGE_SIZE);
+		t = csr_read(CSR_MCYCLE) - t;
+		range = MIN(range, t);
+	}
+
+	/* Cycle counter not ticking so nothing to calibrate */
+	if (!full || !range)
+		return SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT;
+
+	pages = (full * TLB_CALIBRATE_PAGES) / range;
+	pages = MAX(pages, 1UL);
+	pages = MIN(pages, (unsigned long)TLB_CALIBRATE_MAX_PAGES);
+
+	return pages * PAGE_SIZE;
+}
+
+unsigned long sbi_tlb_range_flush_limit(struct sbi_scratch *scratch)
+{
+	if (!tlb_flush_limit_off)
+		return tlb_range_flush_limit;
+
+	return *((unsigned long *)sbi_scratch_offset_ptr(scratch,
+						tlb_flush_limit_off));
+}
+
+bool sbi_tlb_range_flush_limit_calibrated(void)
+{
+	return (tlb_range_flush_limit) ? FALSE : TRUE;
+}
+
 int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 {
 	int ret;
 	void *tlb_mem;
 	unsigned long *tlb_sync;
+	unsigned long *tlb_limit;
+	struct tlb_sticky *tlb_sticky;
 	struct sbi_fifo *tlb_q;
+	struct tlb_bcast *tlb_bcast;
+	struct sbi_hartmask *tlb_bcast_src;
 	const struct sbi_platform *plat = sbi_platform_ptr(scratch);
 
 	if (cold_boot) {
+		ret = SBI_ENOMEM;
 		tlb_sync_off = sbi_scratch_alloc_offset(sizeof(*tlb_sync));
 		if (!tlb_sync_off)
-			return SBI_ENOMEM;
+			return ret;
 		tlb_fifo_off = sbi_scratch_alloc_offset(sizeof(*tlb_q));
-		if (!tlb_fifo_off) {
-			sbi_scratch_free_offset(tlb_sync_off);
-			return SBI_ENOMEM;
-		}
+		if (!tlb_fifo_off)
+			goto fail_free_sync;
 		tlb_fifo_mem_off = sbi_scratch_alloc_offset(
-				SBI_TLB_FIFO_NUM_ENTRIES * SBI_TLB_INFO_SIZE);
-		if (!tlb_fifo_mem_off) {
-			sbi_scratch_free_offset(tlb_fifo_off);
-			sbi_scratch_free_offset(tlb_sync_off);
-			return SBI_ENOMEM;
-		}
-		ret = sbi_ipi_event_create(&tlb_ops);
-		if (ret < 0) {
-			sbi_scratch_free_offset(tlb_fifo_mem_off);
-			sbi_scratch_free_offset(tlb_fifo_off);
-			sbi_scratch_free_offset(tlb_sync_off);
-			return ret;
-		}
+				SBI_FIFO_QUEUE_MEM_SIZE(SBI_TLB_FIFO_NUM_ENTRIES,
+							SBI_TLB_INFO_SIZE));
+		if (!tlb_fifo_mem_off)
+			goto fail_free_fifo;
+		tlb_bcast_off = sbi_scratch_alloc_offset(sizeof(*tlb_bcast));
+		if (!tlb_bcast_off)
+			goto fail_free_fifo_mem;
+		tlb_bcast_src_off = sbi_scratch_alloc_offset(
+						sizeof(*tlb_bcast_src));
+		if (!tlb_bcast_src_off)
+			goto fail_free_bcast;
+		tlb_flush_limit_off = sbi_scratch_alloc_offset(
+						sizeof(*tlb_limit));
+		if (!tlb_flush_limit_off)
+			goto fail_free_bcast_src;
+		tlb_sticky_off = sbi_scratch_alloc_offset(sizeof(*tlb_sticky));
+		if (!tlb_sticky_off)
+			goto fail_free_limit;
+		/* Senders wait for TLB events so process them first */
+		ret = sbi_ipi_event_create(&tlb_ops, SBI_IPI_EVENT_PRIO_HIGH);
+		if (ret < 0)
+			goto fail_free_sticky;
 		tlb_event = ret;
+		ret = sbi_ipi_event_create(&tlb_bcast_ops,
+					   SBI_IPI_EVENT_PRIO_HIGH);
+		if (ret < 0)
+			goto fail_destroy_event;
+		tlb_bcast_event = ret;
+		ret = sbi_ipi_event_create(&tlb_done_ops,
+					   SBI_IPI_EVENT_PRIO_NORMAL);
+		if (ret < 0)
+			goto fail_destroy_bcast_event;
+		tlb_done_event = ret;
 		tlb_range_flush_limit = sbi_platform_tlbr_flush_limit(plat);
 	} else {
 		if (!tlb_sync_off ||
 		    !tlb_fifo_off ||
-		    !tlb_fifo_mem_off)
+		    !tlb_fifo_mem_off ||
+		    !tlb_bcast_off ||
+		    !tlb_bcast_src_off ||
+		    !tlb_flush_limit_off ||
+		    !tlb_sticky_off)
 			return SBI_ENOMEM;
-		if (SBI_IPI_EVENT_MAX <= tlb_event)
+		if (SBI_IPI_EVENT_MAX <= tlb_event ||
+		    SBI_IPI_EVENT_MAX <= tlb_bcast_event ||
+		    SBI_IPI_EVENT_MAX <= tlb_done_event)
 			return SBI_ENOSPC;
 	}
 
 	tlb_sync = sbi_scratch_offset_ptr(scratch, tlb_sync_off);
 	tlb_q = sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
 	tlb_mem = sbi_scratch_offset_ptr(scratch, tlb_fifo_mem_off);
+	tlb_bcast = sbi_scratch_offset_ptr(scratch, tlb_bcast_off);
+	tlb_bcast_src = sbi_scratch_offset_ptr(scratch, tlb_bcast_src_off);
+	tlb_limit = sbi_scratch_offset_ptr(scratch, tlb_flush_limit_off);
+	tlb_sticky = sbi_scratch_offset_ptr(scratch, tlb_sticky_off);
 
 	*tlb_sync = 0;
+	ATOMIC_INIT(&tlb_bcast->pending, 0);
+	tlb_bcast->seq = 0;
+	tlb_bcast->done_seq = 0;
+	tlb_bcast->done_addr = 0;
+	tlb_bcast->reported_seq = 0;
+	tlb_bcast->hartid = current_hartid();
+	tlb_bcast->async = FALSE;
+	sbi_hartmask_clear_all(tlb_bcast_src);
+	ATOMIC_INIT(&tlb_sticky->pending, 0);
+	sbi_hartmask_clear_all(&tlb_sticky->waiters);
+
+	/* Zero limit from platform means calibrate on each HART */
+	if (tlb_range_flush_limit)
+		*tlb_limit = tlb_range_flush_limit;
+	else
+		*tlb_limit = tlb_calibrate_flush_limit();
 
 	sbi_fifo_init(tlb_q, tlb_mem,
 		      SBI_TLB_FIFO_NUM_ENTRIES, SBI_TLB_INFO_SIZE);
 
 	return 0;
+
+fail_destroy_bcast_event:
+	sbi_ipi_event_destroy(tlb_bcast_event);
+	tlb_bcast_event = SBI_IPI_EVENT_MAX;
+fail_destroy_event:
+	sbi_ipi_event_destroy(tlb_event);
+	tlb_event = SBI_IPI_EVENT_MAX;
+fail_free_sticky:
+	sbi_scratch_free_offset(tlb_sticky_off);
+fail_free_limit:
+	sbi_scratch_free_offset(tlb_flush_limit_off);
+fail_free_bcast_src:
+	sbi_scratch_free_offset(tlb_bcast_src_off);
+fail_free_bcast:
+	sbi_scratch_free_offset(tlb_bcast_off);
+fail_free_fifo_mem:
+	sbi_scratch_free_offset(tlb_fifo_mem_off);
+fail_free_fifo:
+	sbi_scratch_free_offset(tlb_fifo_off);
+fail_free_sync:
+	sbi_scratch_free_offset(tlb_sync_off);
+	return ret;
 }
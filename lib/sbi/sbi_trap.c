@@ -19,9 +19,245 @@
 #include <sbi/sbi_misaligned_ldst.h>
 #include <sbi/sbi_pmu.h>
 #include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
 #include <sbi/sbi_timer.h>
 #include <sbi/sbi_trap.h>
 
+struct sbi_trap_stats_entry {
+	u64 cycles;
+	u32 count;
+	u32 hist[SBI_TRAP_STATS_HIST_BUCKETS];
+};
+
+struct sbi_trap_stats {
+	/* Trap currently being handled (nested traps are not accounted) */
+	unsigned long entry_cycle;
+	u32 entry_cause;
+	u32 entry_nested;
+	bool entry_active;
+	struct sbi_trap_stats_entry entries[SBI_XDEBUG_TRAP_CAUSE_MAX];
+};
+
+static const char *const trap_stats_names[SBI_XDEBUG_TRAP_CAUSE_MAX] = {
+	[SBI_XDEBUG_TRAP_CAUSE_IRQ_M_SOFT]		= "irq_m_soft",
+	[SBI_XDEBUG_TRAP_CAUSE_IRQ_M_TIMER]		= "irq_m_timer",
+	[SBI_XDEBUG_TRAP_CAUSE_IRQ_M_EXT]		= "irq_m_ext",
+	[SBI_XDEBUG_TRAP_CAUSE_IRQ_OTHER]		= "irq_other",
+	[SBI_XDEBUG_TRAP_CAUSE_ILLEGAL_INSN]		= "illegal_insn",
+	[SBI_XDEBUG_TRAP_CAUSE_MISALIGNED_LOAD]	= "misaligned_load",
+	[SBI_XDEBUG_TRAP_CAUSE_MISALIGNED_STORE]	= "misaligned_store",
+	[SBI_XDEBUG_TRAP_CAUSE_ECALL]			= "ecall",
+	[SBI_XDEBUG_TRAP_CAUSE_REDIRECT]		= "redirect",
+	[SBI_XDEBUG_TRAP_CAUSE_EXCP_OTHER]		= "excp_other",
+};
+
+/* Offset of per-HART trap statistics (zero when disabled) */
+static unsigned long trap_stats_off;
+
+static u32 sbi_trap_stats_cause(ulong mcause)
+{
+	if (mcause & (1UL << (__riscv_xlen - 1))) {
+		switch (mcause & ~(1UL << (__riscv_xlen - 1))) {
+		case IRQ_M_SOFT:
+			return SBI_XDEBUG_TRAP_CAUSE_IRQ_M_SOFT;
+		case IRQ_M_TIMER:
+			return SBI_XDEBUG_TRAP_CAUSE_IRQ_M_TIMER;
+		case IRQ_M_EXT:
+			return SBI_XDEBUG_TRAP_CAUSE_IRQ_M_EXT;
+		default:
+			return SBI_XDEBUG_TRAP_CAUSE_IRQ_OTHER;
+		}
+	}
+
+	switch (mcause) {
+	case CAUSE_ILLEGAL_INSTRUCTION:
+		return SBI_XDEBUG_TRAP_CAUSE_ILLEGAL_INSN;
+	case CAUSE_MISALIGNED_LOAD:
+		return SBI_XDEBUG_TRAP_CAUSE_MISALIGNED_LOAD;
+	case CAUSE_MISALIGNED_STORE:
+		return SBI_XDEBUG_TRAP_CAUSE_MISALIGNED_STORE;
+	case CAUSE_SUPERVISOR_ECALL:
+	case CAUSE_MACHINE_ECALL:
+		return SBI_XDEBUG_TRAP_CAUSE_ECALL;
+	default:
+		/* Changed to redirect by sbi_trap_redirect() if taken */
+		return SBI_XDEBUG_TRAP_CAUSE_EXCP_OTHER;
+	}
+}
+
+/*
+ * The entry time is sampled by the caller as the first thing in C so
+ * the register save of the low-level trap entry is not accounted.
+ */
+static void sbi_trap_stats_enter(ulong mcause, ulong entry_cycle)
+{
+	struct sbi_trap_stats *stats =
+			sbi_scratch_thishart_offset_ptr(trap_stats_off);
+
+	/* Nested M-mode trap is accounted as part of the outer trap */
+	if (stats->entry_active) {
+		stats->entry_nested++;
+		return;
+	}
+
+	stats->entry_cause = sbi_trap_stats_cause(mcause);
+	stats->entry_active = TRUE;
+	stats->entry_cycle = entry_cycle;
+}
+
+static void sbi_trap_stats_redirect(void)
+{
+	struct sbi_trap_stats *stats;
+
+	if (!trap_stats_off)
+		return;
+
+	stats = sbi_scratch_thishart_offset_ptr(trap_stats_off);
+	if (stats->entry_active)
+		stats->entry_cause = SBI_XDEBUG_TRAP_CAUSE_REDIRECT;
+}
+
+static void sbi_trap_stats_exit(void)
+{
+	u32 bucket;
+	unsigned long cycles, c;
+	struct sbi_trap_stats_entry *e;
+	struct sbi_trap_stats *stats;
+
+	if (!trap_stats_off)
+		return;
+
+	stats = sbi_scratch_thishart_offset_ptr(trap_stats_off);
+	if (!stats->entry_active)
+		return;
+	if (stats->entry_nested) {
+		stats->entry_nested--;
+		return;
+	}
+	cycles = csr_read(CSR_MCYCLE) - stats->entry_cycle;
+	stats->entry_active = FALSE;
+
+	e = &stats->entries[stats->entry_cause];
+	e->count++;
+	e->cycles += cycles;
+
+	bucket = 0;
+	c = cycles;
+	while (c && bucket < (SBI_TRAP_STATS_HIST_BUCKETS - 1)) {
+		c >>= 1;
+		bucket++;
+	}
+	e->hist[bucket]++;
+
+	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_MMODE_TRAPS);
+	sbi_pmu_ctr_add_fw(SBI_PMU_FW_MMODE_CYCLES, cycles);
+}
+
+int sbi_trap_stats_read(u32 hartid, u32 cause, unsigned long stat,
+			unsigned long *out_val)
+{
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+	struct sbi_trap_stats_entry *e;
+	struct sbi_trap_stats *stats;
+
+	if (!trap_stats_off)
+		return SBI_ENOTSUPP;
+	if (!scratch || !out_val || SBI_XDEBUG_TRAP_CAUSE_MAX <= cause)
+		return SBI_EINVAL;
+
+	stats = sbi_scratch_offset_ptr(scratch, trap_stats_off);
+	e = &stats->entries[cause];
+
+	switch (stat) {
+	case SBI_XDEBUG_TRAP_STAT_COUNT:
+		*out_val = e->count;
+		break;
+	case SBI_XDEBUG_TRAP_STAT_CYCLES:
+		*out_val = e->cycles;
+		break;
+	default:
+		stat -= SBI_XDEBUG_TRAP_STAT_CYCLES_HIST(0);
+		if (SBI_TRAP_STATS_HIST_BUCKETS <= stat)
+			return SBI_EINVAL;
+		*out_val = e->hist[stat];
+		break;
+	}
+
+	return 0;
+}
+
+int sbi_trap_stats_reset(u32 hartid)
+{
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+	struct sbi_trap_stats *stats;
+
+	if (!trap_stats_off)
+		return SBI_ENOTSUPP;
+	if (!scratch)
+		return SBI_EINVAL;
+
+	stats = sbi_scratch_offset_ptr(scratch, trap_stats_off);
+	sbi_memset(stats->entries, 0, sizeof(stats->entries));
+
+	return 0;
+}
+
+int sbi_trap_stats_dump(u32 hartid)
+{
+	u32 i, j;
+	struct sbi_trap_stats_entry *e;
+	struct sbi_trap_stats *stats;
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+
+	if (!trap_stats_off)
+		return SBI_ENOTSUPP;
+	if (!scratch)
+		return SBI_EINVAL;
+
+	stats = sbi_scratch_offset_ptr(scratch, trap_stats_off);
+	for (i = 0; i < SBI_XDEBUG_TRAP_CAUSE_MAX; i++) {
+		e = &stats->entries[i];
+		if (!e->count)
+			continue;
+
+		sbi_printf("HART%u %-16s: count=%u cycles=%lu\n",
+			   hartid, trap_stats_names[i], e->count,
+			   (unsigned long)e->cycles);
+		sbi_printf("HART%u %-16s: cycles log2 histogram:",
+			   hartid, trap_stats_names[i]);
+		for (j = 0; j < SBI_TRAP_STATS_HIST_BUCKETS; j++)
+			sbi_printf(" %u", e->hist[j]);
+		sbi_printf("\n");
+	}
+
+	return 0;
+}
+
+int sbi_trap_stats_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	struct sbi_trap_stats *stats;
+
+	if (cold_boot && (scratch->options & SBI_SCRATCH_TRAP_STATS)) {
+		trap_stats_off = sbi_scratch_alloc_offset(
+					sizeof(struct sbi_trap_stats));
+		if (!trap_stats_off)
+			return SBI_ENOMEM;
+	}
+
+	if (!trap_stats_off)
+		return 0;
+
+	/*
+	 * Trap which suspended or stopped this HART never returns so
+	 * this is also called when resuming from non-retentive suspend.
+	 */
+	stats = sbi_scratch_offset_ptr(scratch, trap_stats_off);
+	stats->entry_active = FALSE;
+	stats->entry_nested = 0;
+
+	return 0;
+}
+
 static void __noreturn sbi_trap_error(const char *msg, int rc,
 				      ulong mcause, ulong mtval, ulong mtval2,
 				      ulong mtinst, struct sbi_trap_regs *regs)
@@ -190,6 +426,8 @@ int sbi_trap_redirect(struct sbi_trap_regs *regs,
 		regs->mstatus &= ~MSTATUS_SIE;
 	}
 
+	sbi_trap_stats_redirect();
+
 	return 0;
 }
 
@@ -239,6 +477,41 @@ static int sbi_trap_aia_irq(struct sbi_trap_regs *regs, ulong mcause)
 	return 0;
 }
 
+/**
+ * Handle local interrupt from vectored mode entry
+ *
+ * This function is called by vectored mode entry stubs of firmware
+ * linked to OpenSBI. It dispatches interrupts the same way as the
+ * trap handler (including draining MTOPI when AIA is available) but
+ * only caller saved registers, MEPC and MSTATUS are valid in the
+ * register state.
+ *
+ * @param regs pointer to partially saved register state
+ *
+ * @return 0 on success and negative error code on failure in which
+ * case the firmware falls back to the trap handler
+ */
+int sbi_trap_irq_handler(struct sbi_trap_regs *regs)
+{
+	ulong entry_cycle = trap_stats_off ? csr_read(CSR_MCYCLE) : 0;
+	ulong mcause = csr_read(CSR_MCAUSE);
+	int rc;
+
+	if (trap_stats_off)
+		sbi_trap_stats_enter(mcause, entry_cycle);
+
+	if (sbi_hart_has_extension(sbi_scratch_thishart_ptr(),
+				   SBI_HART_EXT_AIA))
+		rc = sbi_trap_aia_irq(regs, mcause);
+	else
+		rc = sbi_trap_nonaia_irq(regs, mcause);
+
+	/* Also on failure so the fallback trap handler is not nested */
+	sbi_trap_stats_exit();
+
+	return rc;
+}
+
 /**
  * Handle trap/interrupt
  *
@@ -257,12 +530,16 @@ static int sbi_trap_aia_irq(struct sbi_trap_regs *regs, ulong mcause)
  */
 struct sbi_trap_regs *sbi_trap_handler(struct sbi_trap_regs *regs)
 {
+	ulong entry_cycle = trap_stats_off ? csr_read(CSR_MCYCLE) : 0;
 	int rc = SBI_ENOTSUPP;
 	const char *msg = "trap handler failed";
 	ulong mcause = csr_read(CSR_MCAUSE);
 	ulong mtval = csr_read(CSR_MTVAL), mtval2 = 0, mtinst = 0;
 	struct sbi_trap_info trap;
 
+	if (trap_stats_off)
+		sbi_trap_stats_enter(mcause, entry_cycle);
+
 	if (misa_extension('H')) {
 		mtval2 = csr_read(CSR_MTVAL2);
 		mtinst = csr_read(CSR_MTINST);
@@ -278,6 +555,7 @@ struct sbi_trap_regs *sbi_trap_handler(struct sbi_trap_regs *regs)
 			msg = "unhandled local interrupt";
 			goto trap_error;
 		}
+		sbi_trap_stats_exit();
 		return regs;
 	}
 
@@ -318,6 +596,7 @@ struct sbi_trap_regs *sbi_trap_handler(struct sbi_trap_regs *regs)
 trap_error:
 	if (rc)
 		sbi_trap_error(msg, rc, mcause, mtval, mtval2, mtinst, regs);
+	sbi_trap_stats_exit();
 	return regs;
 }
 
@@ -336,6 +615,8 @@ void __noreturn sbi_trap_exit(const struct sbi_trap_regs *regs)
 {
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
 
+	sbi_trap_stats_exit();
+
 	((trap_exit_t)scratch->trap_exit)(regs);
 	__builtin_unreachable();
 }
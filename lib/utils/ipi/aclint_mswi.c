@@ -35,6 +35,30 @@ static void mswi_ipi_send(u32 target_hart)
 	writel(1, &msip[target_hart - mswi->first_hartid]);
 }
 
+static void mswi_ipi_send_mask(const struct sbi_hartmask *mask)
+{
+	u32 *msip;
+	u32 target_hart;
+	struct aclint_mswi_data *mswi;
+
+	/* Order IPI data before all MSIP writes with a single barrier */
+	wmb();
+
+	/*
+	 * HARTs of an MSWI device have consecutive hartids so walking
+	 * the hartmask in order writes each MSWI block together.
+	 */
+	sbi_hartmask_for_each_hart(target_hart, mask) {
+		mswi = mswi_hartid2data[target_hart];
+		if (!mswi)
+			continue;
+
+		/* Set ACLINT IPI */
+		msip = (void *)mswi->addr;
+		writel_relaxed(1, &msip[target_hart - mswi->first_hartid]);
+	}
+}
+
 static void mswi_ipi_clear(u32 target_hart)
 {
 	u32 *msip;
@@ -54,7 +78,8 @@ static void mswi_ipi_clear(u32 target_hart)
 static struct sbi_ipi_device aclint_mswi = {
 	.name = "aclint-mswi",
 	.ipi_send = mswi_ipi_send,
-	.ipi_clear = mswi_ipi_clear
+	.ipi_clear = mswi_ipi_clear,
+	.ipi_send_mask = mswi_ipi_send_mask
 };
 
 int aclint_mswi_warm_init(void)
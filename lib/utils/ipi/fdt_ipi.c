@@ -7,8 +7,11 @@
  *   Anup Patel <anup.patel@wdc.com>
  */
 
+#include <libfdt.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_ipi.h>
 #include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
 #include <sbi_utils/fdt/fdt_helper.h>
 #include <sbi_utils/ipi/fdt_ipi.h>
 
@@ -38,6 +41,57 @@ static int fdt_ipi_warm_init(void)
 	return 0;
 }
 
+/*
+ * Use clusters of the "/cpus/cpu-map" DT node for tree broadcast of
+ * IPIs when the "opensbi,ipi-tree-broadcast" DT property is present
+ * in the "/chosen" DT node.
+ */
+static int fdt_ipi_parse_clusters(void *fdt)
+{
+	u32 hartid;
+	int rc, len, depth, chosen, map, noff, cpu, cluster;
+	const char *name;
+	const fdt32_t *val;
+
+	chosen = fdt_path_offset(fdt, "/chosen");
+	if (chosen < 0 ||
+	    !fdt_getprop(fdt, chosen, "opensbi,ipi-tree-broadcast", NULL))
+		return 0;
+
+	map = fdt_path_offset(fdt, "/cpus/cpu-map");
+	if (map < 0)
+		return 0;
+
+	depth = 0;
+	noff = fdt_next_node(fdt, map, &depth);
+	for (; noff >= 0 && depth > 0; noff = fdt_next_node(fdt, noff, &depth)) {
+		val = fdt_getprop(fdt, noff, "cpu", &len);
+		if (!val || len < sizeof(fdt32_t))
+			continue;
+
+		cpu = fdt_node_offset_by_phandle(fdt, fdt32_to_cpu(*val));
+		if (cpu < 0)
+			continue;
+		rc = fdt_parse_hart_id(fdt, cpu, &hartid);
+		if (rc)
+			continue;
+
+		/* Leaf is either a core or a thread of a core */
+		cluster = fdt_parent_offset(fdt, noff);
+		name = fdt_get_name(fdt, noff, NULL);
+		if (name && !sbi_strncmp(name, "thread", 6))
+			cluster = fdt_parent_offset(fdt, cluster);
+		if (cluster < 0)
+			continue;
+
+		rc = sbi_ipi_set_cluster(hartid, cluster);
+		if (rc)
+			return rc;
+	}
+
+	return 0;
+}
+
 static int fdt_ipi_cold_init(void)
 {
 	int pos, noff, rc;
@@ -65,7 +119,7 @@ static int fdt_ipi_cold_init(void)
 			break;
 	}
 
-	return 0;
+	return fdt_ipi_parse_clusters(fdt);
 }
 
 int fdt_ipi_init(bool cold_boot)
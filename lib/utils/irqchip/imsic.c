@@ -81,6 +81,24 @@ do { \
 
 static struct imsic_data *imsic_hartid2data[SBI_HARTMASK_MAX_BITS];
 static int imsic_hartid2file[SBI_HARTMASK_MAX_BITS];
+static void *imsic_hartid2doorbell[SBI_HARTMASK_MAX_BITS];
+
+static void *imsic_file_doorbell(struct imsic_data *imsic, int file)
+{
+	unsigned long reloff;
+	struct imsic_regs *regs = &imsic->regs[0];
+
+	reloff = file * (1UL << imsic->guest_index_bits) * IMSIC_MMIO_PAGE_SZ;
+	while (regs->size && (regs->size <= reloff)) {
+		reloff -= regs->size;
+		regs++;
+	}
+
+	if (regs->size && (reloff < regs->size))
+		return (void *)(regs->addr + reloff + IMSIC_MMIO_PAGE_LE);
+
+	return NULL;
+}
 
 int imsic_map_hartid_to_data(u32 hartid, struct imsic_data *imsic, int file)
 {
@@ -90,6 +108,7 @@ int imsic_map_hartid_to_data(u32 hartid, struct imsic_data *imsic, int file)
 
 	imsic_hartid2data[hartid] = imsic;
 	imsic_hartid2file[hartid] = file;
+	imsic_hartid2doorbell[hartid] = imsic_file_doorbell(imsic, file);
 	return 0;
 }
 
@@ -108,6 +127,13 @@ int imsic_get_target_file(u32 hartid)
 	return imsic_hartid2file[hartid];
 }
 
+void *imsic_get_target_doorbell(u32 hartid)
+{
+	if (SBI_HARTMASK_MAX_BITS <= hartid)
+		return NULL;
+	return imsic_hartid2doorbell[hartid];
+}
+
 static int imsic_external_irqfn(struct sbi_trap_regs *regs)
 {
 	ulong mirq;
@@ -131,29 +157,31 @@ static int imsic_external_irqfn(struct sbi_trap_regs *regs)
 
 static void imsic_ipi_send(u32 target_hart)
 {
-	unsigned long reloff;
-	struct imsic_regs *regs;
-	struct imsic_data *data = imsic_hartid2data[target_hart];
-	int file = imsic_hartid2file[target_hart];
+	void *doorbell = imsic_hartid2doorbell[target_hart];
 
-	if (!data || !data->targets_mmode)
-		return;
+	if (doorbell)
+		writel(IMSIC_IPI_ID, doorbell);
+}
 
-	regs = &data->regs[0];
-	reloff = file * (1UL << data->guest_index_bits) * IMSIC_MMIO_PAGE_SZ;
-	while (regs->size && (regs->size <= reloff)) {
-		reloff -= regs->size;
-		regs++;
-	}
+static void imsic_ipi_send_mask(const struct sbi_hartmask *mask)
+{
+	u32 target_hart;
+	void *doorbell;
 
-	if (regs->size && (reloff < regs->size))
-		writel(IMSIC_IPI_ID,
-		       (void *)(regs->addr + reloff + IMSIC_MMIO_PAGE_LE));
+	/* Order IPI data before all doorbell writes with a single barrier */
+	wmb();
+
+	sbi_hartmask_for_each_hart(target_hart, mask) {
+		doorbell = imsic_hartid2doorbell[target_hart];
+		if (doorbell)
+			writel_relaxed(IMSIC_IPI_ID, doorbell);
+	}
 }
 
 static struct sbi_ipi_device imsic_ipi_device = {
 	.name		= "aia-imsic",
-	.ipi_send	= imsic_ipi_send
+	.ipi_send	= imsic_ipi_send,
+	.ipi_send_mask	= imsic_ipi_send_mask
 };
 
 static void imsic_local_eix_update(unsigned long base_id,
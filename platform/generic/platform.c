@@ -212,7 +212,7 @@ static u64 generic_tlbr_flush_limit(void)
 {
 	if (generic_plat && generic_plat->tlbr_flush_limit)
 		return generic_plat->tlbr_flush_limit(generic_plat_match);
-	return SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT;
+	return 0;
 }
 
 static int generic_pmu_init(void)